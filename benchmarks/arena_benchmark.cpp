@@ -0,0 +1,93 @@
+/// Compare payloads allocated one by one with malloc (what mmal_pool_create does)
+/// with payloads carved out of an Arena, on 4 KiB pages and on huge pages.
+/// The random access pass is bound by TLB misses, the sequential one by bandwidth.
+/// The Arena doesn't depend on MMAL, so this runs on any host.
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <include/mmalpp_arena.h>
+
+namespace {
+
+constexpr std::size_t buffers = 32;
+constexpr std::size_t size = 1920 * 1088 * 3 / 2;
+constexpr std::size_t accesses = 1 << 22;
+
+struct Result {
+    double random_ns;
+    double sequential_gbs;
+    uint64_t checksum;
+};
+
+Result
+measure(const std::vector<uint8_t*>& payloads)
+{
+    for (uint8_t* p : payloads)
+        std::memset(p, 1, size);
+
+    std::mt19937 rng(42);
+    std::vector<uint32_t> offsets(accesses);
+    for (uint32_t& o : offsets)
+        o = uint32_t(rng() % (buffers * size));
+
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t o : offsets)
+        sum += payloads[o / size][o % size];
+    const std::chrono::duration<double, std::nano> random = std::chrono::steady_clock::now() - start;
+
+    start = std::chrono::steady_clock::now();
+    for (int pass = 0; pass < 4; ++pass)
+        for (uint8_t* p : payloads)
+            for (std::size_t i = 0; i < size; i += 64)
+                sum += p[i];
+    const std::chrono::duration<double> sequential = std::chrono::steady_clock::now() - start;
+
+    return {random.count() / accesses, 4.0 * buffers * size / sequential.count() / 1e9, sum};
+}
+
+void
+print(const std::string& name, const Result& r)
+{
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << r.random_ns << " ns" << std::setw(10) << r.sequential_gbs << " GB/s"
+              << "  checksum " << r.checksum << std::endl;
+}
+
+}
+
+int main()
+{
+    std::cout << std::left << std::setw(24) << "payloads" << std::right << std::setw(13) << "random"
+              << std::setw(15) << "sequential" << std::endl;
+    {
+        std::vector<uint8_t*> payloads;
+        for (std::size_t i = 0; i < buffers; ++i)
+            payloads.push_back(static_cast<uint8_t*>(std::malloc(size)));
+        print("malloc", measure(payloads));
+        for (uint8_t* p : payloads)
+            std::free(p);
+    }
+    for (bool huge : {false, true}) {
+        mmalpp::Arena arena(size, buffers, {4096, huge, false});
+        std::vector<uint8_t*> payloads;
+        for (std::size_t i = 0; i < buffers; ++i)
+            payloads.push_back(static_cast<uint8_t*>(arena.allocate(size)));
+        std::string name = "arena";
+        if (arena.huge_pages())
+            name += " (hugetlb)";
+        else if (arena.transparent_huge_pages())
+            name += " (thp)";
+        else if (huge)
+            name += " (no huge pages)";
+        print(name, measure(payloads));
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+/// Compare the per-buffer dispatch cost of a std::function callback (the old
+/// port callback) and of the inline storage with a static trampoline used by
+/// Generic_port::enable(). The storage doesn't depend on MMAL, so this runs on
+/// any host. Each call also goes through a C function pointer, like MMAL does.
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <include/utils/mmalpp_callback_utils.h>
+
+using namespace mmalpp::mmalpp_impl_;
+
+namespace {
+
+constexpr uint64_t iterations = 50000000;
+
+/// What MMAL passes to the port callback.
+struct Fake_header { uint32_t length; };
+using c_callback_ = void (*)(void*, Fake_header*);
+
+struct Function_data {
+    std::function<void(Fake_header&)> callback;
+};
+
+struct Storage_data {
+    Callback_storage_ callback;
+};
+
+void
+function_trampoline(void* userdata, Fake_header* header)
+{
+    try {
+        static_cast<Function_data*>(userdata)->callback(*header);
+    } catch (std::exception&)
+    {}
+}
+
+template <typename F_>
+void
+storage_trampoline(void* userdata, Fake_header* header)
+{
+    try {
+        static_cast<Storage_data*>(userdata)->callback.get<F_>()(*header);
+    } catch (...)
+    {}
+}
+
+/// Call cb through a volatile function pointer, so the compiler can't see the target.
+double
+ns_per_call(c_callback_ cb, void* userdata)
+{
+    c_callback_ volatile target = cb;
+    Fake_header header{1};
+    const auto start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; ++i)
+        target(userdata, &header);
+    const std::chrono::duration<double, std::nano> d = std::chrono::steady_clock::now() - start;
+    return d.count() / iterations;
+}
+
+void
+print(const std::string& name, double function, double storage)
+{
+    std::cout << std::left << std::setw(20) << name << std::right << std::fixed << std::setprecision(2)
+              << std::setw(10) << function << " ns" << std::setw(10) << storage << " ns"
+              << std::setw(8) << function / storage << "x" << std::endl;
+}
+
+template <typename F_>
+void
+compare(const std::string& name, F_ f)
+{
+    Function_data function{f};
+    Storage_data storage;
+    storage.callback.emplace(f);
+    print(name, ns_per_call(&function_trampoline, &function),
+          ns_per_call(&storage_trampoline<F_>, &storage));
+}
+
+}
+
+int main()
+{
+    uint64_t bytes = 0;
+    char padding[48] = {};
+
+    std::cout << std::left << std::setw(20) << "callback" << std::right
+              << std::setw(13) << "function" << std::setw(13) << "inline" << std::setw(9) << "speedup"
+              << std::endl;
+    compare("capture pointer", [&bytes] (Fake_header& h) { bytes += h.length; });
+    compare("capture 56 bytes", [&bytes, padding] (Fake_header& h) { bytes += h.length + uint8_t(padding[0]); });
+
+    std::cout << "bytes: " << bytes << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+/// Compare the scalar reference and the SIMD colour conversion kernels.
+/// The kernels don't depend on MMAL, so this runs on any host.
+
+#include <chrono>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <include/utils/mmalpp_convert_utils.h>
+
+using namespace mmalpp::mmalpp_impl_;
+
+namespace {
+
+constexpr uint32_t width = 1920;
+constexpr uint32_t height = 1088;
+constexpr int iterations = 50;
+
+template <typename F>
+double
+ms_per_frame(F&& f)
+{
+    f();
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i)
+        f();
+    const std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count() / iterations;
+}
+
+/// Run the scalar and SIMD version of a conversion, check they match and print timings.
+template <typename F>
+bool
+compare(const std::string& name, std::size_t dst_size, F&& f)
+{
+    std::vector<uint8_t> ref(dst_size), out(dst_size);
+    const double scalar = ms_per_frame([&] { f(std::false_type{}, ref.data()); });
+    const double simd = ms_per_frame([&] { f(std::true_type{}, out.data()); });
+    const bool same = (ref == out);
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(10) << scalar << " ms" << std::setw(10) << simd << " ms"
+              << std::setw(8) << std::setprecision(2) << scalar / simd << "x"
+              << (same ? "" : "  MISMATCH") << std::endl;
+    return same;
+}
+
+}
+
+int main()
+{
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> byte(0, 255);
+    const std::size_t luma = std::size_t(width) * height;
+    std::vector<uint8_t> yuv(luma * 3 / 2), yuyv(luma * 2);
+    for (auto& b : yuv) b = uint8_t(byte(rng));
+    for (auto& b : yuyv) b = uint8_t(byte(rng));
+
+    const uint8_t* y = yuv.data();
+    const uint8_t* u = y + luma;
+    const uint8_t* v = u + luma / 4;
+    const uint32_t cw = width / 2, ch = height / 2;
+
+    std::cout << width << "x" << height << ", " << iterations << " iterations, SIMD: "
+              << convert_isa_() << std::endl;
+    std::cout << std::left << std::setw(16) << "conversion" << std::right
+              << std::setw(13) << "scalar" << std::setw(13) << "simd" << std::setw(9) << "speedup" << std::endl;
+
+    bool ok = true;
+    ok &= compare("I420->NV12", luma / 2, [&](auto simd, uint8_t* d) {
+        i420_to_nv12_chroma_<decltype(simd)::value>(u, cw, v, cw, d, width, cw, ch);
+    });
+    ok &= compare("NV12->I420", luma / 2, [&](auto simd, uint8_t* d) {
+        nv12_to_i420_chroma_<decltype(simd)::value>(u, width, d, cw, d + luma / 4, cw, cw, ch);
+    });
+    ok &= compare("YUYV->I420", luma * 3 / 2, [&](auto simd, uint8_t* d) {
+        yuyv_to_i420_<decltype(simd)::value>(yuyv.data(), width * 2, d, width, d + luma, cw,
+                                             d + luma + luma / 4, cw, width, height);
+    });
+    ok &= compare("I420->RGB24", luma * 3, [&](auto simd, uint8_t* d) {
+        yuv420_to_packed_<Pixel_order_::RGB24, false, decltype(simd)::value>(
+                    y, width, u, cw, v, cw, d, width * 3, width, height);
+    });
+    ok &= compare("I420->BGR24", luma * 3, [&](auto simd, uint8_t* d) {
+        yuv420_to_packed_<Pixel_order_::BGR24, false, decltype(simd)::value>(
+                    y, width, u, cw, v, cw, d, width * 3, width, height);
+    });
+    ok &= compare("I420->RGBA", luma * 4, [&](auto simd, uint8_t* d) {
+        yuv420_to_packed_<Pixel_order_::RGBA, false, decltype(simd)::value>(
+                    y, width, u, cw, v, cw, d, width * 4, width, height);
+    });
+    ok &= compare("NV12->RGB24", luma * 3, [&](auto simd, uint8_t* d) {
+        yuv420_to_packed_<Pixel_order_::RGB24, true, decltype(simd)::value>(
+                    y, width, u, width, nullptr, 0, d, width * 3, width, height);
+    });
+    ok &= compare("NV12->RGBA", luma * 4, [&](auto simd, uint8_t* d) {
+        yuv420_to_packed_<Pixel_order_::RGBA, true, decltype(simd)::value>(
+                    y, width, u, width, nullptr, 0, d, width * 4, width, height);
+    });
+
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,83 @@
+/// Compare the throughput of Queue (MMAL_QUEUE_T, a mutex on every put and get)
+/// with the lock-free Spsc_queue and Mpmc_queue, with 1, 2 and 4 producer threads
+/// and one consumer thread. Headers are not allocated from a Pool and carry no
+/// payload: only the transport is measured.
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mmalpp.h>
+
+namespace {
+
+constexpr std::size_t buffers_per_producer = 200000;
+constexpr std::size_t capacity = 1024;
+
+/// Run producers threads putting buffers_per_producer headers each and one
+/// consumer getting them all, and return the millions of Buffers per second.
+template <typename Queue_>
+double
+run(Queue_& queue, std::size_t producers)
+{
+    std::vector<MMAL_BUFFER_HEADER_T> headers(buffers_per_producer * producers);
+    const std::size_t total = headers.size();
+    std::atomic<bool> go{false};
+
+    std::vector<std::thread> threads;
+    for (std::size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            while (!go.load(std::memory_order_acquire))
+            {}
+            for (std::size_t i = 0; i < buffers_per_producer; ++i)
+                queue.put(mmalpp::Buffer(&headers[p * buffers_per_producer + i]));
+        });
+
+    const auto start = std::chrono::steady_clock::now();
+    go.store(true, std::memory_order_release);
+    for (std::size_t received = 0; received < total;)
+        if (!queue.get_buffer(-1).is_null())
+            ++received;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    for (std::thread& t : threads)
+        t.join();
+    return double(total) / elapsed.count() / 1e6;
+}
+
+void
+report(const std::string& name, std::size_t producers, double mops)
+{
+    std::cout << std::left << std::setw(14) << name << std::right
+              << std::setw(10) << producers
+              << std::setw(12) << std::fixed << std::setprecision(2) << mops << std::endl;
+}
+
+}
+
+int
+main()
+{
+    std::cout << std::left << std::setw(14) << "queue" << std::right
+              << std::setw(10) << "producers" << std::setw(12) << "Mbuf/s" << std::endl;
+
+    for (std::size_t producers : {1, 2, 4}) {
+        mmalpp::Queue queue;
+        report("Queue", producers, run(queue, producers));
+        queue.release();
+
+        if (producers == 1) {
+            mmalpp::Spsc_queue spsc(capacity);
+            report("Spsc_queue", producers, run(spsc, producers));
+        }
+
+        mmalpp::Mpmc_queue mpmc(capacity);
+        report("Mpmc_queue", producers, run(mpmc, producers));
+    }
+    return 0;
+}
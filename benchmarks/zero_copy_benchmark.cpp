@@ -0,0 +1,94 @@
+/// Measure the host CPU time spent per raw frame delivered by the camera video
+/// port to the ARM side, with and without zero-copy buffers. Without zero-copy
+/// every frame is copied through the VCHIQ transport. It needs a Raspberry Pi
+/// with a camera.
+
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+
+#include <sys/resource.h>
+
+#include <mmalpp.h>
+
+namespace {
+
+constexpr int frames = 300;
+constexpr auto format = mmalpp::Video_format(1920, 1080, MMAL_ENCODING_I420).frame_rate(30, 1);
+
+/// User plus system CPU time of the process, in milliseconds.
+double
+cpu_ms()
+{
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1e3
+            + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e3;
+}
+
+struct Result {
+    bool zero_copy;
+    double cpu_ms_per_frame;
+    double fps;
+};
+
+Result
+run(bool zero_copy)
+{
+    mmalpp::Component camera("vc.ril.camera");
+    mmalpp::Port<mmalpp::OUTPUT>& video = camera.output(1);
+
+    std::mutex mutex;
+    std::condition_variable done;
+    int received = 0;
+    uint64_t checksum = 0;
+
+    video.set_format(format);
+    video.commit();
+    video.set_default_buffer();
+    const bool accepted = video.create_pool(video.buffer_num(), uint32_t(video.buffer_size()), zero_copy);
+
+    /// Read one byte per page, as a consumer which only looks at the frame would do.
+    video.enable_auto_recycle([&] (mmalpp::Generic_port&, const mmalpp::Buffer& buffer) {
+        for (uint32_t i = 0; i < buffer.size(); i += 4096)
+            checksum += buffer[i];
+        std::lock_guard<std::mutex> lock(mutex);
+        if (++received == frames)
+            done.notify_one();
+    });
+
+    camera.enable();
+    video.send_all_buffers();
+    video.parameter().set_boolean(MMAL_PARAMETER_CAPTURE, true);
+
+    const double cpu_start = cpu_ms();
+    const auto start = std::chrono::steady_clock::now();
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&] { return received >= frames; });
+    }
+    const double cpu = cpu_ms() - cpu_start;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+    video.parameter().set_boolean(MMAL_PARAMETER_CAPTURE, false);
+    camera.close();
+
+    std::cout << "checksum " << checksum << std::endl;
+    return {accepted, cpu / frames, frames / elapsed.count()};
+}
+
+}
+
+int main()
+{
+    const Result copy = run(false);
+    const Result zero = run(true);
+    std::cout << std::fixed << std::setprecision(3)
+              << "copy:      " << copy.cpu_ms_per_frame << " ms CPU/frame, " << copy.fps << " fps" << std::endl
+              << "zero-copy: " << zero.cpu_ms_per_frame << " ms CPU/frame, " << zero.fps << " fps"
+              << (zero.zero_copy ? "" : " (not accepted by the port)") << std::endl
+              << "saved:     " << copy.cpu_ms_per_frame - zero.cpu_ms_per_frame << " ms CPU/frame" << std::endl;
+    return 0;
+}
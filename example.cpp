@@ -19,10 +19,12 @@ int main()
     /// Set parameters
     camera.control().parameter().set_header(&change_event_request.hdr);
 
-    /// Passing callback with lambda expression
-    camera.control().enable([](mmalpp::Generic_port& port, mmalpp::Buffer buffer){
-        if (port.is_enabled())
-            buffer.release();
+    /// Passing event handler with lambda expression
+    camera.control().enable_events([](mmalpp::Generic_port&, const mmalpp::Event& event){
+        if (auto changed = std::get_if<mmalpp::Parameter_changed_event>(&event))
+            std::cout << "parameter " << changed->id << " changed" << std::endl;
+        else if (auto error = std::get_if<mmalpp::Error_event>(&event))
+            std::cerr << "camera error " << error->status << std::endl;
     });
 
     MMAL_PARAMETER_CAMERA_CONFIG_T camConfig = {
@@ -0,0 +1,231 @@
+#ifndef MMALPP_ARENA_H
+#define MMALPP_ARENA_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Options of an Arena.
+struct Arena_options {
+
+    /// Alignment of every slot. It must be a power of two, e.g. 64 (cache line)
+    /// or 4096 (page).
+    std::size_t alignment = 64;
+
+    /// Back the arena with huge pages: explicit ones (MAP_HUGETLB) if the system
+    /// has some reserved, transparent ones (MADV_HUGEPAGE) otherwise.
+    bool huge_pages = false;
+
+    /// Lock the arena in memory (mlock), so it is never paged out.
+    bool lock = false;
+
+};
+
+/// Fixed size slots carved out of one contiguous, pre-faulted memory mapping.
+/// It is used as the payload allocator of host Pools (see Pool), so that all
+/// their Buffers are adjacent and aligned: fewer TLB misses when they are
+/// processed, and no fragmentation of the heap.
+/// Allocation and deallocation take a lock: MMAL only calls them when a Pool is
+/// created or resized, not when Buffers are recycled.
+class Arena {
+
+public:
+
+    /// ctor. Map slots slots of at least slot_size bytes each.
+    Arena(std::size_t slot_size,
+          std::size_t slots,
+          const Arena_options& options = {})
+        : slots_(slots)
+    {
+        const std::size_t alignment = options.alignment ? options.alignment : 1;
+        if (alignment & (alignment - 1))
+            throw std::invalid_argument("arena alignment must be a power of two");
+
+        const std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+        stride_ = align_(slot_size ? slot_size : 1, alignment);
+        const std::size_t used = stride_ * slots;
+        mapped_ = align_(used + (alignment > page ? alignment : 0), page);
+        const std::size_t first_alignment = map_(options.huge_pages, used);
+
+        uint8_t* first = reinterpret_cast<uint8_t*>(align_(reinterpret_cast<std::size_t>(base_),
+                                                           std::max(alignment, first_alignment)));
+        free_.reserve(slots);
+        for (std::size_t i = slots; i > 0; --i)
+            free_.push_back(first + (i - 1) * stride_);
+
+        if (options.lock)
+            locked_ = (mlock(base_, mapped_) == 0);
+    }
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /// dtor.
+    ~Arena()
+    {
+        if (locked_)
+            munlock(base_, mapped_);
+        munmap(base_, mapped_);
+    }
+
+    /**
+     * Get a free slot for size bytes. It returns nullptr if size is larger
+     * than a slot or no slot is free.
+     */
+    void*
+    allocate(std::size_t size)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (size > stride_ || free_.empty())
+            return nullptr;
+        void* slot = free_.back();
+        free_.pop_back();
+        return slot;
+    }
+
+    /**
+     * Give a slot back.
+     */
+    void
+    deallocate(void* slot)
+    {
+        if (!slot)
+            return;
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(slot);
+    }
+
+    /**
+     * Get the usable size of a slot (slot_size rounded up to the alignment).
+     */
+    std::size_t
+    slot_size() const
+    { return stride_; }
+
+    /**
+     * Get the number of slots.
+     */
+    std::size_t
+    slots() const
+    { return slots_; }
+
+    /**
+     * Get the number of free slots.
+     */
+    std::size_t
+    available() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return free_.size();
+    }
+
+    /**
+     * Get the number of mapped bytes.
+     */
+    std::size_t
+    bytes() const
+    { return mapped_; }
+
+    /**
+     * Check if the arena is backed by explicit huge pages (MAP_HUGETLB).
+     */
+    bool
+    huge_pages() const
+    { return hugetlb_; }
+
+    /**
+     * Check if transparent huge pages have been requested (MADV_HUGEPAGE).
+     */
+    bool
+    transparent_huge_pages() const
+    { return thp_; }
+
+    /**
+     * Check if the arena is locked in memory.
+     */
+    bool
+    locked() const
+    { return locked_; }
+
+private:
+    std::size_t slots_;
+    std::size_t stride_ = 0;
+    std::size_t mapped_ = 0;
+    void* base_ = nullptr;
+    bool hugetlb_ = false;
+    bool thp_ = false;
+    bool locked_ = false;
+    mutable std::mutex mutex_;
+    std::vector<void*> free_;
+
+    static std::size_t
+    align_(std::size_t n, std::size_t alignment)
+    { return (n + alignment - 1) & ~(alignment - 1); }
+
+    /// Map the arena and return the alignment its first slot needs.
+    std::size_t
+    map_(bool huge_pages, std::size_t used)
+    {
+        /// Huge pages are 2 MiB on ARM and x86 Linux.
+        constexpr std::size_t huge = std::size_t(2) << 20;
+        const int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#ifdef MAP_HUGETLB
+        if (huge_pages) {
+            const std::size_t length = align_(mapped_, huge);
+            void* p = mmap(nullptr, length, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB | populate_(), -1, 0);
+            if (p != MAP_FAILED) {
+                base_ = p;
+                mapped_ = length;
+                hugetlb_ = true;
+                return 1;
+            }
+        }
+#endif
+        if (!huge_pages) {
+            base_ = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, flags | populate_(), -1, 0);
+            if (base_ == MAP_FAILED)
+                throw std::bad_alloc();
+            return 1;
+        }
+
+        /// Transparent huge pages: the slots start on a huge page boundary, and
+        /// pages are faulted in only after madvise() so that they can be huge.
+        mapped_ = align_(used, huge) + huge;
+        base_ = mmap(nullptr, mapped_, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (base_ == MAP_FAILED)
+            throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+        thp_ = (madvise(base_, mapped_, MADV_HUGEPAGE) == 0);
+#endif
+        const std::size_t page = std::size_t(sysconf(_SC_PAGESIZE));
+        for (std::size_t i = 0; i < mapped_; i += page)
+            static_cast<volatile uint8_t*>(base_)[i] = 0;
+        return huge;
+    }
+
+    static int
+    populate_()
+    {
+#ifdef MAP_POPULATE
+        return MAP_POPULATE;
+#else
+        return 0;
+#endif
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_ARENA_H
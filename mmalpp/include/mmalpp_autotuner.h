@@ -0,0 +1,151 @@
+#ifndef MMALPP_AUTOTUNER_H
+#define MMALPP_AUTOTUNER_H
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#include "mmalpp_port.h"
+#include "mmalpp_connection.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Options of a Pool_autotuner.
+struct Autotuner_options {
+
+    /// Bounds of the number of Buffers. The lower one is raised to the
+    /// minimum of the port.
+    std::size_t min_headers = 1;
+    std::size_t max_headers = 16;
+
+    /// Buffers added when the Pool starves.
+    std::size_t grow_step = 1;
+
+    /// The Pool shrinks by one Buffer when at least spare_headers have been
+    /// idle in its queue at every tick for shrink_after ticks in a row.
+    std::size_t spare_headers = 2;
+    std::size_t shrink_after = 10;
+
+};
+
+/// Adaptive sizing of the Pool of an output port. Call tick() periodically from a
+/// control thread (not from the port callback): it looks at the starvation
+/// events counted by the library since the last tick (pool queue empty when a
+/// Buffer had to be sent back, see Generic_port::recycle_metrics()) and at the
+/// Buffers idle in the Pool queue, then grows or shrinks the Pool within the
+/// bounds through Generic_port::resize_pool(). Starvation is counted when the
+/// library recycles Buffers, so the port should be in auto recycle or offload mode.
+/// Every decision is logged, with the mean time a Buffer spends out of the Pool
+/// (dwell time, from the throughput by Little's law), so the result can be pinned.
+class Pool_autotuner {
+
+public:
+
+    using log_type = std::function<void(const std::string&)>;
+
+    /// ctor. By default decisions are logged to std::clog.
+    Pool_autotuner(Generic_port& port,
+                   const Autotuner_options& options = {},
+                   log_type log = nullptr)
+        : port_(port),
+          options_(options),
+          log_(log ? std::move(log) : log_type([] (const std::string& line) { std::clog << line << std::endl; })),
+          last_(port.recycle_metrics()),
+          last_buffers_(port.stats().buffers),
+          last_tick_(std::chrono::steady_clock::now())
+    {
+        options_.min_headers = std::max({options_.min_headers, port.buffer_num_min(), std::size_t(1)});
+        options_.max_headers = std::max(options_.max_headers, options_.min_headers);
+    }
+
+    /**
+     * Look at the Pool and resize it if needed. It returns true if the Pool
+     * has been resized. A port without a Pool is left alone.
+     */
+    bool
+    tick()
+    {
+        if (port_.pool().is_null())
+            return false;
+
+        const Recycle_metrics recycle = port_.recycle_metrics();
+        const Port_stats stats = port_.stats();
+        const auto now = std::chrono::steady_clock::now();
+        const std::chrono::duration<double> elapsed = now - last_tick_;
+
+        const uint64_t starved = recycle.starved - last_.starved;
+        const double rate = elapsed.count() > 0 ? (stats.buffers - last_buffers_) / elapsed.count() : 0;
+        const std::size_t in_use = stats.pool_size - stats.pool_available;
+        dwell_ms_ = rate > 0 ? 1e3 * double(in_use) / rate : 0;
+
+        last_ = recycle;
+        last_buffers_ = stats.buffers;
+        last_tick_ = now;
+
+        if (stats.pool_available >= options_.spare_headers)
+            ++spare_ticks_;
+        else
+            spare_ticks_ = 0;
+
+        const std::size_t headers = stats.pool_size;
+        if (starved && headers < options_.max_headers) {
+            std::ostringstream why;
+            why << starved << " starvation events";
+            return resize_(headers, std::min(headers + options_.grow_step, options_.max_headers), why.str());
+        }
+        if (spare_ticks_ >= options_.shrink_after && headers > options_.min_headers) {
+            std::ostringstream why;
+            why << stats.pool_available << " idle buffers for " << spare_ticks_ << " ticks";
+            return resize_(headers, headers - 1, why.str());
+        }
+        return false;
+    }
+
+    /**
+     * Get the mean time a Buffer spent out of the Pool at the last tick, in ms.
+     */
+    double
+    dwell_ms() const
+    { return dwell_ms_; }
+
+private:
+    Generic_port& port_;
+    Autotuner_options options_;
+    log_type log_;
+    Recycle_metrics last_;
+    uint64_t last_buffers_;
+    std::chrono::steady_clock::time_point last_tick_;
+    std::size_t spare_ticks_ = 0;
+    double dwell_ms_ = 0;
+
+    bool
+    resize_(std::size_t from, std::size_t to, const std::string& why)
+    {
+        std::ostringstream line;
+        line << "[mmalpp] pool autotuner " << port_.get()->name << ": "
+             << (to > from ? "grow " : "shrink ") << from << " -> " << to
+             << " buffers (" << why << ", dwell " << dwell_ms_ << " ms)";
+        try {
+            port_.resize_pool(to);
+        } catch (const std::exception& e) {
+            /// The port runs on with its Pool: try again at a later tick.
+            line << " failed: " << e.what();
+            log_(line.str());
+            return false;
+        }
+        spare_ticks_ = 0;
+        last_ = port_.recycle_metrics();
+        log_(line.str());
+        return true;
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_AUTOTUNER_H
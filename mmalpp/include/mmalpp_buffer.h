@@ -1,85 +1,25 @@
 #ifndef MMALPP_BUFFER_H
 #define MMALPP_BUFFER_H
 
-#include <iterator>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+#include <string>
 
 #include <interface/mmal/mmal_types.h>
 #include <interface/mmal/mmal_buffer.h>
 
 #include "utils/mmalpp_buffer_utils.h"
+#include "mmalpp_span.h"
 #include "../macros.h"
 
 MMALPP_BEGIN
 
-/// Iterator
-class Buffer_iterator {
-
-public:
-
-    using value_type = uint8_t;
-    using iterator_category = std::input_iterator_tag;
-    using difference_type = std::ptrdiff_t;
-    using pointer = uint8_t*;
-    using reference = uint8_t&;
-    using const_reference = const uint8_t&;
-
-    /// ctor.
-    Buffer_iterator(uint8_t* data,
-                    uint32_t length,
-                    bool end = false)
-        : data_(data),
-          length_(length),
-          pos_((end) ? length - 1 : 0)
-    {}
-
-    /// Pre-increment.
-    Buffer_iterator&
-    operator++()
-    {
-        if (pos_ + 1 < length_)
-            ++pos_;
-        return *this;
-    }
-
-    /// Post-increment.
-    Buffer_iterator
-    operator++(int)
-    {
-        Buffer_iterator tmp(*this);
-        ++(*this);
-        return tmp;
-    }
-
-    /// Access non-const.
-    reference
-    operator*()
-    { return data_[pos_]; }
-
-    /// Access const.
-    const_reference
-    operator*() const
-    { return data_[pos_]; }
-
-private:
-    const pointer data_; /// data ptr
-    const std::size_t length_; /// length
-    std::size_t pos_; /// actual position
-
-};
-
-/******************************************************************/
-
-/// operator== overload.
-inline bool
-operator==(const Buffer_iterator& a,
-           const Buffer_iterator& b)
-{ return &*a == &*b; }
-
-/// operator!= overload.
-inline bool
-operator!=(const Buffer_iterator& a,
-           const Buffer_iterator& b)
-{ return !(a == b); }
+/// Iterator. Buffer data is a contiguous byte array, so plain pointers are used
+/// as iterators: they are random-access and contiguous, which lets algorithms
+/// like std::copy or vector::insert collapse into a single memmove.
+using Buffer_iterator = uint8_t*;
+using Buffer_const_iterator = const uint8_t*;
 
 /******************************************************************/
 
@@ -92,7 +32,7 @@ public:
     using reference = uint8_t&;
     using const_reference = const uint8_t&;
     using iterator = Buffer_iterator;
-    using const_iterator = const Buffer_iterator;
+    using const_iterator = Buffer_const_iterator;
 
     /// ctor.
     Buffer(MMAL_BUFFER_HEADER_T* buffer)
@@ -123,6 +63,23 @@ public:
     release()
     { mmalpp_impl_::release_buffer_header_(buffer_); }
 
+    /**
+     * Set a pre-release callback. It is invoked when the last reference is released,
+     * just before the buffer header is recycled. If it returns MMAL_TRUE recycling is
+     * postponed until release_continue() is called. Pass nullptr to remove it.
+     */
+    void
+    set_pre_release(MMAL_BH_PRE_RELEASE_CB_T cb, void* userdata = nullptr)
+    { mmalpp_impl_::buffer_header_set_callback_(buffer_, cb, userdata); }
+
+    /**
+     * Complete the recycling of a buffer header whose release was postponed
+     * by its pre-release callback.
+     */
+    void
+    release_continue()
+    { mmalpp_impl_::buffer_header_continue_release_(buffer_); }
+
     /**
      * Copy meta-data of Buffer. It copies presentation timestamp, decoding timestamp,
      * command, flags, type.
@@ -146,11 +103,12 @@ public:
     void
     copy_from(const Buffer& buffer)
     {
-        if (allocated_size() < buffer.allocated_size())
+        if (allocated_size() < buffer.size())
             throw std::length_error("Not enough allocated memory to store data. "
                                     "Actual: " + std::to_string(allocated_size()) +
-                                    "Required: " + std::to_string(buffer.allocated_size()));
-        std::copy(buffer.begin(), buffer.end(), begin());
+                                    " Required: " + std::to_string(buffer.size()));
+        if (buffer.size())
+            std::memcpy(buffer_->data, buffer.payload().data(), buffer.size());
         copy_meta(buffer);
         buffer_->offset = 0;
         buffer_->length = buffer.size();
@@ -254,49 +212,80 @@ public:
 
     /**
      * Buffer hold data as a byte array.
-     * You can have access to data pointer by [] operator.
+     * You can have access to the payload by [] operator: buffer[0] is the
+     * first byte after offset, the same as *begin().
      * This operator doesn't do bound check.
      */
     uint8_t&
     operator[](uint32_t n)
-    { return *(buffer_->data + n); }
+    { return *(buffer_->data + buffer_->offset + n); }
 
     /**
      * Buffer hold data as a byte array.
-     * You can have access to data pointer by [] operator.
+     * You can have access to the payload by [] operator: buffer[0] is the
+     * first byte after offset, the same as *begin().
      * This operator doesn't do bound check.
      */
     const uint8_t&
     operator[](uint32_t n) const
-    { return *(buffer_->data + n); }
+    { return *(buffer_->data + buffer_->offset + n); }
 
     /**
-     * Begin iterator.
+     * Get a view over the valid payload, that is the bytes in
+     * [data + offset, data + offset + length).
+     */
+    Span<uint8_t>
+    payload()
+    { return {buffer_->data + buffer_->offset, buffer_->length}; }
+
+    /**
+     * Get a const view over the valid payload.
+     */
+    Span<const uint8_t>
+    payload() const
+    { return {buffer_->data + buffer_->offset, buffer_->length}; }
+
+    /**
+     * Get a view over the whole allocated memory of the Buffer.
+     */
+    Span<uint8_t>
+    allocation()
+    { return {buffer_->data, buffer_->alloc_size}; }
+
+    /**
+     * Get a const view over the whole allocated memory of the Buffer.
+     */
+    Span<const uint8_t>
+    allocation() const
+    { return {buffer_->data, buffer_->alloc_size}; }
+
+    /**
+     * Begin iterator. It points at the first byte of the payload.
      */
     iterator
     begin()
-    { return {buffer_->data, buffer_->alloc_size}; }
+    { return payload().begin(); }
 
     /**
-     * End iterator.
+     * End iterator. It points one past the last byte of the payload.
      */
     iterator
     end()
-    { return {buffer_->data, buffer_->alloc_size, true}; }
+    { return payload().end(); }
 
     /**
      * Begin const-iterator.
      */
     const_iterator
     begin() const
-    { return {buffer_->data, buffer_->alloc_size}; }
+    { return payload().begin(); }
 
     /**
      * End const-iterator.
      */
     const_iterator
     end() const
-    { return {buffer_->data, buffer_->alloc_size, true}; }
+    { return payload().end(); }
 
     /**
      * Get the MMAL_BUFFER_HEADER_T pointer.
@@ -310,12 +299,131 @@ private:
 
 };
 
+/// Owning Buffer handle. It holds one reference on a buffer header and releases
+/// it when destroyed, so it can only be moved. Use share() to get another handle
+/// on the same header (it acquires a new reference).
+class Unique_buffer {
+
+public:
+
+    /// ctors.
+    Unique_buffer() noexcept
+        : buffer_(nullptr)
+    {}
+
+    /// Take ownership of a reference already held by the caller, e.g. the one
+    /// received in a port callback or taken from a queue.
+    explicit Unique_buffer(Buffer buffer) noexcept
+        : buffer_(buffer)
+    {}
+
+    explicit Unique_buffer(MMAL_BUFFER_HEADER_T* buffer) noexcept
+        : buffer_(buffer)
+    {}
+
+    Unique_buffer(Unique_buffer&& other) noexcept
+        : buffer_(other.detach())
+    {}
+
+    Unique_buffer&
+    operator=(Unique_buffer&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            buffer_ = other.detach();
+        }
+        return *this;
+    }
+
+    Unique_buffer(const Unique_buffer&) = delete;
+    Unique_buffer& operator=(const Unique_buffer&) = delete;
+
+    /// dtor.
+    ~Unique_buffer()
+    { release(); }
+
+    /**
+     * Get another handle on the same buffer header. It acquires a new reference,
+     * so the header will be recycled only when both handles are gone.
+     */
+    Unique_buffer
+    share() const
+    {
+        mmalpp_impl_::acquire_buffer_header_(buffer_.get());
+        return Unique_buffer(buffer_);
+    }
+
+    /**
+     * Release the owned reference now. The handle becomes null.
+     */
+    void
+    release() noexcept
+    {
+        if (!buffer_.is_null()) {
+            buffer_.release();
+            buffer_ = Buffer(nullptr);
+        }
+    }
+
+    /**
+     * Give up ownership without releasing the reference and return it
+     * as a plain Buffer. The handle becomes null.
+     */
+    Buffer
+    detach() noexcept
+    {
+        Buffer tmp = buffer_;
+        buffer_ = Buffer(nullptr);
+        return tmp;
+    }
+
+    /**
+     * Check is this handle owns a buffer header.
+     */
+    bool
+    is_null() const noexcept
+    { return buffer_.is_null(); }
+
+    explicit
+    operator bool() const noexcept
+    { return !buffer_.is_null(); }
+
+    /**
+     * Access the owned Buffer (non-owning view).
+     */
+    Buffer&
+    operator*() noexcept
+    { return buffer_; }
+
+    const Buffer&
+    operator*() const noexcept
+    { return buffer_; }
+
+    Buffer*
+    operator->() noexcept
+    { return &buffer_; }
+
+    const Buffer*
+    operator->() const noexcept
+    { return &buffer_; }
+
+    /**
+     * Get the MMAL_BUFFER_HEADER_T pointer.
+     */
+    MMAL_BUFFER_HEADER_T*
+    get() const noexcept
+    { return buffer_.get(); }
+
+private:
+    Buffer buffer_;
+
+};
+
 /// USED FOR DEBUG
 inline std::ostream& operator<<(std::ostream& os, const Buffer& b)
 {
-    for (auto i = b.begin(); i != b.end(); ++i)
-        os << *i;
-    return os;
+    return os.write(reinterpret_cast<const char*>(b.payload().data()),
+                    static_cast<std::streamsize>(b.payload().size()));
 }
 
 MMALPP_END
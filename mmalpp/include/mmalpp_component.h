@@ -2,6 +2,7 @@
 #define MMALPP_COMPONENT_H
 
 #include <string>
+#include <vector>
 
 #include "mmalpp_port.h"
 #include "mmalpp_connection.h"
@@ -37,6 +38,25 @@ public:
         mmalpp_impl_::release_component_(component_);
     }
 
+    /**
+     * Bring the component back to its state after creation, without destroying
+     * it: disconnect it from the others, disable it and its ports, release
+     * the Pools of its ports and clear their handlers and counters (see
+     * Generic_port::clear_handlers()). The port formats committed on VideoCore
+     * are kept, so it can be used again at once (see Component_cache).
+     */
+    void
+    reset()
+    {
+        mmalpp_impl_::disconnect_ports_(output_);
+        mmalpp_impl_::disconnect_inputs_(input_);
+        if (is_enable())
+            disable();
+        mmalpp_impl_::reset_(output_);
+        mmalpp_impl_::reset_(input_);
+        mmalpp_impl_::reset_single_(control_);
+    }
+
     /**
      * Disconnect this component from others. This method must be call
      * for each component before call the close method.
@@ -0,0 +1,296 @@
+#ifndef MMALPP_COMPONENT_CACHE_H
+#define MMALPP_COMPONENT_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mmalpp_component.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+class Component_cache;
+
+/// Counters of a Component_cache.
+struct Component_cache_metrics {
+
+    /// Components handed out from the idle ones, and created on demand.
+    uint64_t hits = 0;
+    uint64_t misses = 0;
+
+    /// Idle components closed because the cache was full or reset() failed.
+    uint64_t evicted = 0;
+
+    /// Components idle in the cache now.
+    std::size_t idle = 0;
+
+};
+
+/// A Component borrowed from a Component_cache. When it is destroyed (or
+/// release() is called) the Component is reset and goes back to the cache
+/// instead of being closed. It must not outlive the cache.
+class Cached_component {
+
+public:
+
+    /// ctor.
+    Cached_component() noexcept = default;
+
+    Cached_component(Cached_component&& other) noexcept = default;
+
+    Cached_component&
+    operator=(Cached_component&& other) noexcept
+    {
+        if (this != &other) {
+            release();
+            cache_ = other.cache_;
+            key_ = std::move(other.key_);
+            component_ = std::move(other.component_);
+        }
+        return *this;
+    }
+
+    Cached_component(const Cached_component&) = delete;
+    Cached_component& operator=(const Cached_component&) = delete;
+
+    /// dtor.
+    ~Cached_component()
+    { release(); }
+
+    /**
+     * Give the Component back to the cache now.
+     */
+    inline void
+    release();
+
+    /**
+     * Check if a Component is held.
+     */
+    explicit operator bool() const noexcept
+    { return component_ != nullptr; }
+
+    /**
+     * Access the Component.
+     */
+    Component&
+    operator*() const noexcept
+    { return *component_; }
+
+    Component*
+    operator->() const noexcept
+    { return component_.get(); }
+
+    Component*
+    get() const noexcept
+    { return component_.get(); }
+
+private:
+    friend class Component_cache;
+
+    Component_cache* cache_ = nullptr;
+    std::string key_;
+    std::unique_ptr<Component> component_;
+
+    Cached_component(Component_cache* cache, std::string key, std::unique_ptr<Component> component)
+        : cache_(cache),
+          key_(std::move(key)),
+          component_(std::move(component))
+    {}
+
+};
+
+/// Cache of Components, so that on-demand capture sessions don't pay for
+/// mmal_component_create() and its release (hundreds of ms for a camera or an
+/// encoder) every time. Components are keyed by name and by a configuration
+/// string: configure runs once, when a Component is created (e.g. to set its
+/// parameters and commit its formats), and the Component goes back to the
+/// cache reset but still configured, so the next session with the same key
+/// starts from it. The configuration string must name what configure does.
+/// At most max_idle Components are kept idle; the least recently used ones are
+/// closed beyond that. It is thread safe.
+class Component_cache {
+
+public:
+
+    using configure_type = std::function<void(Component&)>;
+
+    /// ctor.
+    explicit Component_cache(std::size_t max_idle = 2)
+        : max_idle_(max_idle)
+    {}
+
+    Component_cache(const Component_cache&) = delete;
+    Component_cache& operator=(const Component_cache&) = delete;
+
+    /// dtor. It closes the idle Components.
+    ~Component_cache()
+    { clear(); }
+
+    /**
+     * Get a Component: an idle one with the same name and configuration if
+     * any, otherwise a new one, configured by configure.
+     */
+    Cached_component
+    acquire(const std::string& name,
+            const std::string& configuration = std::string(),
+            const configure_type& configure = nullptr)
+    {
+        std::string key = key_(name, configuration);
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            for (auto it = idle_.begin(); it != idle_.end(); ++it)
+                if (it->first == key) {
+                    std::unique_ptr<Component> component = std::move(it->second);
+                    idle_.erase(it);
+                    ++hits_;
+                    return Cached_component(this, std::move(key), std::move(component));
+                }
+            ++misses_;
+        }
+        return Cached_component(this, std::move(key), create_(name, configure));
+    }
+
+    /**
+     * Create n Components ahead of the first session and keep them idle
+     * (within max_idle), e.g. at startup.
+     */
+    void
+    prewarm(const std::string& name,
+            const std::string& configuration = std::string(),
+            const configure_type& configure = nullptr,
+            std::size_t n = 1)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            give_back_(key_(name, configuration), create_(name, configure), false);
+    }
+
+    /**
+     * Close every idle Component.
+     */
+    void
+    clear()
+    {
+        std::list<Entry_> idle;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle.swap(idle_);
+        }
+        for (Entry_& e : idle)
+            close_(*e.second);
+    }
+
+    /**
+     * Get the number of idle Components.
+     */
+    std::size_t
+    idle() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return idle_.size();
+    }
+
+    /**
+     * Get the counters of the cache.
+     */
+    Component_cache_metrics
+    metrics() const
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        Component_cache_metrics m;
+        m.hits = hits_;
+        m.misses = misses_;
+        m.evicted = evicted_;
+        m.idle = idle_.size();
+        return m;
+    }
+
+private:
+    friend class Cached_component;
+
+    using Entry_ = std::pair<std::string, std::unique_ptr<Component>>;
+
+    const std::size_t max_idle_;
+    mutable std::mutex mutex_;
+    /// Idle Components, the most recently used first.
+    std::list<Entry_> idle_;
+    uint64_t hits_ = 0;
+    uint64_t misses_ = 0;
+    uint64_t evicted_ = 0;
+
+    static std::string
+    key_(const std::string& name, const std::string& configuration)
+    { return name + '\0' + configuration; }
+
+    static std::unique_ptr<Component>
+    create_(const std::string& name, const configure_type& configure)
+    {
+        auto component = std::make_unique<Component>(name);
+        if (configure) {
+            try {
+                configure(*component);
+            } catch (...) {
+                close_(*component);
+                throw;
+            }
+        }
+        return component;
+    }
+
+    static void
+    close_(Component& component) noexcept
+    {
+        try {
+            component.close();
+        } catch (...) {}
+    }
+
+    /// Take a Component back, resetting it if it has been used.
+    void
+    give_back_(std::string key, std::unique_ptr<Component> component, bool used) noexcept
+    {
+        if (used) {
+            try {
+                component->reset();
+            } catch (...) {
+                close_(*component);
+                std::lock_guard<std::mutex> lock(mutex_);
+                ++evicted_;
+                return;
+            }
+        }
+        std::vector<std::unique_ptr<Component>> evicted;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            idle_.emplace_front(std::move(key), std::move(component));
+            while (idle_.size() > max_idle_) {
+                evicted.push_back(std::move(idle_.back().second));
+                idle_.pop_back();
+                ++evicted_;
+            }
+        }
+        for (std::unique_ptr<Component>& c : evicted)
+            close_(*c);
+    }
+
+};
+
+inline void
+Cached_component::release()
+{
+    if (component_) {
+        cache_->give_back_(std::move(key_), std::move(component_), true);
+        component_.reset();
+        key_.clear();
+    }
+}
+
+MMALPP_END
+
+#endif // MMALPP_COMPONENT_CACHE_H
@@ -1,16 +1,60 @@
 #ifndef MMALPP_CONNECTION_H
 #define MMALPP_CONNECTION_H
 
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
 #include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_events.h>
 #include <interface/mmal/util/mmal_connection.h>
 
+#include "mmalpp_buffer.h"
 #include "mmalpp_port.h"
+#include "mmalpp_stats.h"
+#include "mmalpp_types.h"
 #include "mmalpp_fwd_decl.h"
+#include "utils/mmalpp_callback_utils.h"
 #include "utils/mmalpp_connection_utils.h"
+#include "utils/mmalpp_queue_utils.h"
 #include "../macros.h"
 
 MMALPP_BEGIN
 
+/// Snapshot of a connection (see Connection::metrics()).
+struct Connection_metrics {
+
+    /// Time MMAL took to set up, enable and disable the connection, in microseconds.
+    int64_t setup_us = 0;
+    int64_t enable_us = 0;
+    int64_t disable_us = 0;
+
+    /// Pool of the connection (none if it is tunnelled): its size, the Buffers
+    /// in its queue, those returned by the source and not forwarded yet, and
+    /// those held by the ports.
+    std::size_t pool_size = 0;
+    std::size_t pool_available = 0;
+    std::size_t queued = 0;
+    std::size_t in_flight = 0;
+
+    /// Host side, only for tapped connections (see Connection::tap()), since
+    /// the connection has been enabled.
+    uint64_t forwarded = 0;
+    uint64_t dropped = 0;
+    uint64_t bytes = 0;
+    double buffers_per_second = 0;
+    double bytes_per_second = 0;
+
+    /// Statistics of the source and target ports. Their VideoCore side is
+    /// there for tunnelled connections too.
+    Port_stats source;
+    Port_stats target;
+
+};
+
 class Connection {
 
 public:
@@ -26,11 +70,14 @@ public:
           target_(target)
     { target->connection_ = this; }
 
+    Connection(const Connection&) = delete;
+    Connection& operator=(const Connection&) = delete;
+
     /**
-     * Check if it exists.
+     * Check if it exists (it doesn't after release()).
      */
     bool
-    is_null()
+    is_null() const
     { return connection_ == nullptr; }
 
     /**
@@ -55,11 +102,108 @@ public:
     { return *target_; }
 
     /**
-     * Enable the connection.
+     * Set a tap on a connection which is not tunnelled: every Buffer the source
+     * port returns is passed to callback before it goes on to the target port,
+     * and the connection Pool feeds the source port again. The header itself is
+     * passed along, so the callback can read the payload or change the header
+     * (pts, flags, user_data...) without copying. It returns FORWARD to send the
+     * Buffer to the target port or DROP to release it (a void callback always
+     * forwards, a throwing one drops). Buffers are tapped one at a time, in the
+     * order the source returned them, from the MMAL callback threads: the
+     * callback must be as quick as a port callback.
+     * It must be set while the connection is disabled.
+     */
+    template <typename F_>
+    void
+    tap(F_&& callback)
+    {
+        if (connection_->flags & MMAL_CONNECTION_FLAG_TUNNELLING)
+            throw std::logic_error("a tunnelled connection can't be tapped");
+        if (connection_->is_enabled)
+            throw std::logic_error("the tap must be set while the connection is disabled");
+        tap_.emplace(std::forward<F_>(callback));
+        connection_->user_data = this;
+        connection_->callback = &tap_trampoline_<std::decay_t<F_>>;
+    }
+
+    /**
+     * Check if the connection has a tap.
+     */
+    bool
+    is_tapped() const
+    { return !tap_.empty(); }
+
+    /**
+     * Set the number of Buffers of the connection, and their size if size is
+     * not 0, on both ports. MMAL sizes the connection Pool from them when the
+     * connection is enabled, so it must be disabled. Values below the minimum
+     * of the ports are raised to it. It sets MMAL_CONNECTION_FLAG_KEEP_BUFFER_REQUIREMENTS,
+     * otherwise MMAL would replace them with the recommended ones on enable.
+     */
+    void
+    set_buffer_count(uint32_t num, uint32_t size = 0)
+    {
+        if (connection_->is_enabled)
+            throw std::logic_error("the buffer count must be set while the connection is disabled");
+        MMAL_PORT_T* out = connection_->out;
+        MMAL_PORT_T* in = connection_->in;
+        num = std::max({num, out->buffer_num_min, in->buffer_num_min});
+        out->buffer_num = in->buffer_num = num;
+        if (size) {
+            size = std::max({size, out->buffer_size_min, in->buffer_size_min});
+            out->buffer_size = in->buffer_size = size;
+        }
+        connection_->flags |= MMAL_CONNECTION_FLAG_KEEP_BUFFER_REQUIREMENTS;
+    }
+
+    /**
+     * Get the timings MMAL recorded for the connection, the occupancy of its
+     * Pool, the throughput of a tapped connection and the statistics of both
+     * ports, e.g. to find the bottleneck of a camera -> encoder -> sink chain.
+     */
+    Connection_metrics
+    metrics() const
+    {
+        Connection_metrics m;
+        m.setup_us = connection_->time_setup;
+        m.enable_us = connection_->time_enable;
+        m.disable_us = connection_->time_disable;
+        if (MMAL_POOL_T* pool = connection_->pool) {
+            m.pool_size = pool->headers_num;
+            m.pool_available = mmalpp_impl_::get_queue_lenght_(pool->queue);
+        }
+        if (connection_->queue)
+            m.queued = mmalpp_impl_::get_queue_lenght_(connection_->queue);
+        if (m.pool_size > m.pool_available + m.queued)
+            m.in_flight = m.pool_size - m.pool_available - m.queued;
+
+        Port_stats forwarded;
+        counters_.snapshot(forwarded);
+        m.forwarded = forwarded.buffers;
+        m.dropped = dropped_.load(std::memory_order_relaxed);
+        m.bytes = forwarded.bytes;
+        m.buffers_per_second = forwarded.buffers_per_second;
+        m.bytes_per_second = forwarded.bytes_per_second;
+
+        m.source = source_->stats();
+        m.target = target_->stats();
+        return m;
+    }
+
+    /**
+     * Enable the connection. It resets the host side metrics. A tapped
+     * connection feeds the source port with the Buffers of its Pool, since
+     * MMAL only does it for connections without a callback.
      */
     void
     enable()
-    { mmalpp_impl_::enable_connection_(connection_); }
+    {
+        counters_.reset();
+        dropped_ = 0;
+        mmalpp_impl_::enable_connection_(connection_);
+        if (is_tapped())
+            connection_->callback(connection_);
+    }
 
     /**
      * Disable the connection.
@@ -75,6 +219,7 @@ public:
     release()
     {
         mmalpp_impl_::destroy_connection_(connection_);
+        connection_ = nullptr;
         target_->connection_ = nullptr;
     }
 
@@ -90,8 +235,91 @@ private:
     Port<OUTPUT>* source_;
     Port<INPUT>* target_;
 
+    /// Tap callback, and the calls of the trampoline not served yet.
+    mmalpp_impl_::Callback_storage_ tap_;
+    std::atomic<unsigned> tap_pending_{0};
+
+    /// Buffers forwarded and dropped by the tap, recorded by the draining thread.
+    mmalpp_impl_::Port_counters_ counters_;
+    std::atomic<uint64_t> dropped_{0};
+
+    /**
+     * Callback of a tapped connection, called by MMAL whenever the source returns
+     * a Buffer or a Buffer goes back to the connection Pool. Only one thread at
+     * a time drains the connection: the others leave their call to it, so the
+     * Buffers are tapped and forwarded in order.
+     */
+    template <typename F_>
+    static void
+    tap_trampoline_(MMAL_CONNECTION_T* connection)
+    {
+        Connection& self = *static_cast<Connection*>(connection->user_data);
+        if (self.tap_pending_.fetch_add(1, std::memory_order_acq_rel))
+            return;
+        unsigned served;
+        do {
+            served = self.tap_pending_.load(std::memory_order_acquire);
+            self.drain_<F_>();
+        } while (self.tap_pending_.fetch_sub(served, std::memory_order_acq_rel) != served);
+    }
+
+    /// Tap and forward the Buffers returned by the source, then feed it again.
+    template <typename F_>
+    void
+    drain_()
+    {
+        F_& f = tap_.get<F_>();
+        MMAL_BUFFER_HEADER_T* buffer;
+        while ((buffer = mmal_queue_get(connection_->queue))) {
+            if (buffer->cmd) {
+                if (buffer->cmd == MMAL_EVENT_FORMAT_CHANGED)
+                    mmal_connection_event_format_changed(connection_, buffer);
+                mmal_buffer_header_release(buffer);
+                continue;
+            }
+            Buffer tapped(buffer);
+            TAP_ACTION action = FORWARD;
+            try {
+                if constexpr (std::is_void<std::invoke_result_t<F_&, Buffer&>>::value)
+                    f(tapped);
+                else
+                    action = f(tapped);
+            } catch (...) {
+                action = DROP;
+            }
+            const uint32_t length = buffer->length;
+            if (action == FORWARD && connection_->in->is_enabled
+                    && mmal_port_send_buffer(connection_->in, buffer) == MMAL_SUCCESS)
+                counters_.arrival(length, mmalpp_impl_::Port_counters_::now());
+            else {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                mmal_buffer_header_release(buffer);
+            }
+        }
+        while (connection_->out->is_enabled && (buffer = mmal_queue_get(connection_->pool->queue)))
+            if (mmal_port_send_buffer(connection_->out, buffer) != MMAL_SUCCESS) {
+                mmal_queue_put_back(connection_->pool->queue, buffer);
+                break;
+            }
+    }
+
 };
 
+inline bool
+Port<OUTPUT>::is_connected() const
+{ return connection_ && !connection_->is_null(); }
+
+template <typename F_>
+inline bool
+Port<OUTPUT>::tap_to(Port<INPUT>& target, F_&& callback, uint32_t flags, bool zero_copy)
+{
+    if (flags & MMAL_CONNECTION_FLAG_TUNNELLING)
+        throw std::invalid_argument("a tunnelled connection can't be tapped");
+    const bool accepted = connect_to(target, flags, zero_copy);
+    connection_->tap(std::forward<F_>(callback));
+    return accepted;
+}
+
 MMALPP_END
 
 #endif // MMALPP_CONNECTION_H
@@ -0,0 +1,135 @@
+#ifndef MMALPP_CONVERT_H
+#define MMALPP_CONVERT_H
+
+#include <stdexcept>
+#include <string>
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_format.h>
+#include <interface/mmal/mmal_encodings.h>
+
+#include "utils/mmalpp_convert_utils.h"
+#include "mmalpp_buffer.h"
+#include "mmalpp_frame.h"
+#include "mmalpp_pool.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+template <Pixel_order_ O_>
+inline void
+yuv420_view_to_packed_(const Frame_view<const uint8_t>& src_, const Frame_view<>& dst_)
+{
+    const Plane<const uint8_t> y = src_.plane(0);
+    const Plane<const uint8_t> u = src_.plane(1);
+    const Plane<uint8_t> d = dst_.plane(0);
+    if (src_.encoding() == MMAL_ENCODING_NV12)
+        yuv420_to_packed_<O_, true>(y.data, y.stride, u.data, u.stride, nullptr, 0,
+                                    d.data, d.stride, src_.width(), src_.height());
+    else {
+        const Plane<const uint8_t> v = src_.plane(2);
+        yuv420_to_packed_<O_, false>(y.data, y.stride, u.data, u.stride, v.data, v.stride,
+                                     d.data, d.stride, src_.width(), src_.height());
+    }
+}
+
+};
+
+/**
+ * Convert the frame seen by src into the frame seen by dst. Both views must
+ * have the same visible size. Supported conversions are I420 <-> NV12,
+ * I420/NV12 -> RGB24/BGR24/RGBA/BGRA and YUYV -> I420. It uses NEON or SSE2
+ * kernels when they are available. A writable src view is taken as read-only.
+ */
+inline void
+convert(const Frame_view<const uint8_t>& src, const Frame_view<>& dst)
+{
+    using namespace mmalpp_impl_;
+
+    if (src.width() != dst.width() || src.height() != dst.height())
+        throw std::invalid_argument("cannot convert frames of different size");
+
+    const MMAL_FOURCC_T from = src.encoding();
+    const MMAL_FOURCC_T to = dst.encoding();
+    const bool yuv420 = (from == MMAL_ENCODING_I420 || from == MMAL_ENCODING_NV12);
+
+    if (from == MMAL_ENCODING_I420 && to == MMAL_ENCODING_NV12) {
+        const Plane<const uint8_t> sy = src.plane(0), su = src.plane(1), sv = src.plane(2);
+        const Plane<uint8_t> dy = dst.plane(0), duv = dst.plane(1);
+        copy_plane_(sy.data, sy.stride, dy.data, dy.stride, sy.width, sy.height);
+        i420_to_nv12_chroma_(su.data, su.stride, sv.data, sv.stride,
+                             duv.data, duv.stride, su.width, su.height);
+    } else if (from == MMAL_ENCODING_NV12 && to == MMAL_ENCODING_I420) {
+        const Plane<const uint8_t> sy = src.plane(0), suv = src.plane(1);
+        const Plane<uint8_t> dy = dst.plane(0), du = dst.plane(1), dv = dst.plane(2);
+        copy_plane_(sy.data, sy.stride, dy.data, dy.stride, sy.width, sy.height);
+        nv12_to_i420_chroma_(suv.data, suv.stride, du.data, du.stride,
+                             dv.data, dv.stride, du.width, du.height);
+    } else if (from == MMAL_ENCODING_YUYV && to == MMAL_ENCODING_I420) {
+        const Plane<const uint8_t> s = src.plane(0);
+        const Plane<uint8_t> dy = dst.plane(0), du = dst.plane(1), dv = dst.plane(2);
+        yuyv_to_i420_(s.data, s.stride, dy.data, dy.stride, du.data, du.stride,
+                      dv.data, dv.stride, src.width(), src.height());
+    } else if (yuv420 && to == MMAL_ENCODING_RGB24)
+        yuv420_view_to_packed_<Pixel_order_::RGB24>(src, dst);
+    else if (yuv420 && to == MMAL_ENCODING_BGR24)
+        yuv420_view_to_packed_<Pixel_order_::BGR24>(src, dst);
+    else if (yuv420 && to == MMAL_ENCODING_RGBA)
+        yuv420_view_to_packed_<Pixel_order_::RGBA>(src, dst);
+    else if (yuv420 && to == MMAL_ENCODING_BGRA)
+        yuv420_view_to_packed_<Pixel_order_::BGRA>(src, dst);
+    else
+        throw std::invalid_argument("conversion not supported");
+}
+
+/**
+ * Convert a Buffer produced by a port with the given format into dst, using
+ * the given encoding. The destination keeps the aligned width and height of
+ * the format and the visible region starts at its top-left corner.
+ * It sets length, offset, timestamps and flags of dst.
+ */
+inline void
+convert(const Buffer& src,
+        const MMAL_ES_FORMAT_T* format,
+        Buffer& dst,
+        MMAL_FOURCC_T encoding)
+{
+    const Frame_view from(src, format);
+    const MMAL_RECT_T crop = {0, 0, int32_t(from.width()), int32_t(from.height())};
+    const Frame_view to(dst.data(), encoding, format->es->video.width,
+                        format->es->video.height, crop);
+    if (dst.allocated_size() < to.size())
+        throw std::length_error("Not enough allocated memory to store the frame. "
+                                "Actual: " + std::to_string(dst.allocated_size()) +
+                                " Required: " + std::to_string(to.size()));
+    convert(from, to);
+    dst.get()->offset = 0;
+    dst.get()->length = uint32_t(to.size());
+    dst.get()->pts = src.presentation_timestamp();
+    dst.get()->dts = src.decoding_timestamp();
+    dst.get()->flags = src.flags();
+}
+
+/**
+ * Convert a Buffer produced by a port with the given format into a Buffer
+ * taken from pool, using the given encoding. It returns a null Unique_buffer
+ * if no Buffer is available within timeout_ms (see Pool::get_buffer).
+ */
+inline Unique_buffer
+convert(const Buffer& src,
+        const MMAL_ES_FORMAT_T* format,
+        Pool& pool,
+        MMAL_FOURCC_T encoding,
+        int timeout_ms = 0)
+{
+    Unique_buffer dst(pool.get_buffer(timeout_ms));
+    if (dst)
+        convert(src, format, *dst, encoding);
+    return dst;
+}
+
+MMALPP_END
+
+#endif // MMALPP_CONVERT_H
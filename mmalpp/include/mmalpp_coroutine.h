@@ -0,0 +1,331 @@
+#ifndef MMALPP_COROUTINE_H
+#define MMALPP_COROUTINE_H
+
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <interface/mmal/mmal_buffer.h>
+#include <interface/mmal/mmal_port.h>
+
+#include "mmalpp_buffer.h"
+#include "mmalpp_executor.h"
+#include "mmalpp_pool.h"
+#include "mmalpp_queue.h"
+#include "utils/mmalpp_buffer_utils.h"
+#include "utils/mmalpp_port_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/// Something waiting on a Buffer_channel_.
+class Channel_waiter_ {
+
+public:
+
+    /**
+     * Take a buffer header (and its reference). Return true when the wait is over.
+     */
+    virtual bool
+    offer(MMAL_BUFFER_HEADER_T* buffer) = 0;
+
+    /**
+     * End the wait without a buffer header: the channel has been closed.
+     */
+    virtual void
+    close()
+    {}
+
+    /**
+     * Resume the waiter, once the wait is over.
+     */
+    virtual void
+    wake() = 0;
+
+protected:
+    ~Channel_waiter_() = default;
+
+};
+
+/**
+ * Buffers returned by a port whose callback feeds coroutines (see
+ * Generic_port::enable_awaitable()). The callback offers every buffer header to
+ * the waiting coroutine, or keeps it until one waits. Closing the channel
+ * (disabling the port) releases the kept ones and ends the wait.
+ */
+class Buffer_channel_ {
+
+public:
+
+    Buffer_channel_() = default;
+    Buffer_channel_(const Buffer_channel_&) = delete;
+    Buffer_channel_& operator=(const Buffer_channel_&) = delete;
+
+    /// dtor.
+    ~Buffer_channel_()
+    { close(); }
+
+    /**
+     * Hand a buffer header over. Called by the port callback.
+     */
+    void
+    push(MMAL_BUFFER_HEADER_T* buffer)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (closed_) {
+            lock.unlock();
+            release_buffer_header_(buffer);
+            return;
+        }
+        if (!waiter_) {
+            ready_.push_back(buffer);
+            return;
+        }
+        if (!waiter_->offer(buffer))
+            return;
+        Channel_waiter_* waiter = waiter_;
+        waiter_ = nullptr;
+        lock.unlock();
+        waiter->wake();
+    }
+
+    /**
+     * Offer the kept buffer headers to waiter, and make it wait for the next ones
+     * if its wait isn't over. Return false if it is (don't suspend).
+     */
+    bool
+    wait(Channel_waiter_* waiter)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        while (!ready_.empty()) {
+            MMAL_BUFFER_HEADER_T* buffer = ready_.front();
+            ready_.pop_front();
+            if (waiter->offer(buffer))
+                return false;
+        }
+        if (closed_) {
+            waiter->close();
+            return false;
+        }
+        if (waiter_)
+            throw std::logic_error("a coroutine is already waiting for this port");
+        waiter_ = waiter;
+        return true;
+    }
+
+    /**
+     * Stop making waiter wait, if it still does.
+     */
+    void
+    cancel(Channel_waiter_* waiter)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (waiter_ == waiter)
+            waiter_ = nullptr;
+    }
+
+    /**
+     * Accept buffer headers again.
+     */
+    void
+    open()
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        closed_ = false;
+    }
+
+    /**
+     * Release the kept buffer headers and end the current wait.
+     */
+    void
+    close()
+    {
+        std::deque<MMAL_BUFFER_HEADER_T*> ready;
+        Channel_waiter_* waiter;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            closed_ = true;
+            ready.swap(ready_);
+            waiter = waiter_;
+            waiter_ = nullptr;
+        }
+        for (MMAL_BUFFER_HEADER_T* buffer : ready)
+            release_buffer_header_(buffer);
+        if (waiter) {
+            waiter->close();
+            waiter->wake();
+        }
+    }
+
+private:
+    std::mutex mutex_;
+    std::deque<MMAL_BUFFER_HEADER_T*> ready_;
+    Channel_waiter_* waiter_ = nullptr;
+    bool closed_ = false;
+
+};
+
+#ifdef MMALPP_HAS_COROUTINES
+
+/**
+ * Common part of the awaitables on a Buffer_channel_.
+ */
+class Channel_awaiter_base_ : protected Channel_waiter_ {
+
+public:
+
+    Channel_awaiter_base_(Buffer_channel_& channel, Executor& executor)
+        : channel_(channel),
+          executor_(executor)
+    {}
+
+    /// dtor. A coroutine destroyed while suspended stops waiting on the channel.
+    ~Channel_awaiter_base_()
+    {
+        if (coroutine_)
+            channel_.cancel(this);
+    }
+
+    bool
+    await_ready() const noexcept
+    { return false; }
+
+    bool
+    await_suspend(std::coroutine_handle<> coroutine)
+    {
+        coroutine_ = coroutine;
+        return channel_.wait(this);
+    }
+
+protected:
+    Buffer_channel_& channel_;
+    Executor& executor_;
+    std::coroutine_handle<> coroutine_;
+
+    void
+    wake() override
+    { executor_.post(coroutine_); }
+
+};
+
+/**
+ * Awaitable of Generic_port::next_buffer(): the next Buffer returned by the port,
+ * null if the port has been disabled.
+ */
+class Buffer_awaiter_ final : public Channel_awaiter_base_ {
+
+public:
+
+    using Channel_awaiter_base_::Channel_awaiter_base_;
+
+    Unique_buffer
+    await_resume()
+    { return std::move(buffer_); }
+
+private:
+    Unique_buffer buffer_;
+
+    bool
+    offer(MMAL_BUFFER_HEADER_T* buffer) override
+    {
+        buffer_ = Unique_buffer(buffer);
+        return true;
+    }
+
+};
+
+/**
+ * Awaitable of Generic_port::capture_done(): every Buffer returned by the port up
+ * to the end of a frame (MMAL_BUFFER_HEADER_FLAG_FRAME_END) or of the stream
+ * (MMAL_BUFFER_HEADER_FLAG_EOS), in order. The last one doesn't have either flag
+ * if the port has been disabled before.
+ */
+class Capture_awaiter_ final : public Channel_awaiter_base_ {
+
+public:
+
+    using Channel_awaiter_base_::Channel_awaiter_base_;
+
+    std::vector<Unique_buffer>
+    await_resume()
+    { return std::move(buffers_); }
+
+private:
+    std::vector<Unique_buffer> buffers_;
+
+    bool
+    offer(MMAL_BUFFER_HEADER_T* buffer) override
+    {
+        buffers_.emplace_back(buffer);
+        return buffer->flags & (MMAL_BUFFER_HEADER_FLAG_FRAME_END | MMAL_BUFFER_HEADER_FLAG_EOS);
+    }
+
+};
+
+/**
+ * Awaitable of Generic_port::flush_complete(). It flushes the port and watches
+ * the queue of its Pool until every Buffer is back in it.
+ */
+class Flush_awaiter_ final : Queue_watcher_ {
+
+public:
+
+    Flush_awaiter_(MMAL_PORT_T* port, MMAL_POOL_T* pool, Executor& executor)
+        : port_(port),
+          pool_(pool),
+          executor_(executor)
+    {}
+
+    /// dtor. A coroutine destroyed while suspended stops watching the queue.
+    ~Flush_awaiter_()
+    {
+        if (coroutine_)
+            unwatch_queue_(pool_->queue, this);
+    }
+
+    bool
+    await_ready() const noexcept
+    { return false; }
+
+    bool
+    await_suspend(std::coroutine_handle<> coroutine)
+    {
+        coroutine_ = coroutine;
+        /// Released Buffers must tell the watchers of the queue.
+        watch_pool_releases_(pool_);
+        watch_queue_(pool_->queue, this);
+        flush_port_(port_);
+        notify_queue_(pool_->queue);
+        return true;
+    }
+
+    void
+    await_resume() const noexcept
+    {}
+
+private:
+    MMAL_PORT_T* port_;
+    MMAL_POOL_T* pool_;
+    Executor& executor_;
+    std::coroutine_handle<> coroutine_;
+
+    bool
+    ready(MMAL_QUEUE_T* queue) override
+    { return get_queue_lenght_(queue) >= pool_->headers_num; }
+
+    void
+    fire() override
+    { executor_.post(coroutine_); }
+
+};
+
+#endif
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_COROUTINE_H
@@ -0,0 +1,188 @@
+#ifndef MMALPP_DEFERRED_RELEASE_H
+#define MMALPP_DEFERRED_RELEASE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_buffer.h>
+
+#include "mmalpp_buffer.h"
+#include "mmalpp_pool.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Deferred recycling of the Buffers of a Pool. A consumer can hold a Buffer
+/// (e.g. hand it to a worker thread), release it as usual from the callback and
+/// keep reading its data: the buffer header goes back to the Pool only when every
+/// Hold on it is gone. This avoids copying the payload out before release().
+/// It installs a pre-release callback on the Pool, so it must outlive every Hold
+/// and the Pool must not be resized while it is attached.
+class Deferred_release {
+
+    /// Per header state: number of holds and a flag set when the release
+    /// has been postponed.
+    static constexpr uint32_t deferred_flag_ = 0x80000000u;
+    static constexpr uint32_t holds_mask_ = ~deferred_flag_;
+
+public:
+
+    /// A hold on a Buffer. Move-only, it lets the buffer header be recycled
+    /// when destroyed.
+    class Hold {
+
+    public:
+
+        /// ctors.
+        Hold() noexcept
+            : owner_(nullptr),
+              state_(nullptr),
+              buffer_(nullptr)
+        {}
+
+        Hold(Hold&& other) noexcept
+            : owner_(other.owner_),
+              state_(other.state_),
+              buffer_(other.buffer_)
+        { other.owner_ = nullptr; }
+
+        Hold&
+        operator=(Hold&& other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                owner_ = other.owner_;
+                state_ = other.state_;
+                buffer_ = other.buffer_;
+                other.owner_ = nullptr;
+            }
+            return *this;
+        }
+
+        Hold(const Hold&) = delete;
+        Hold& operator=(const Hold&) = delete;
+
+        /// dtor.
+        ~Hold()
+        { reset(); }
+
+        /**
+         * Drop the hold now. If the buffer has already been released,
+         * it is recycled.
+         */
+        void
+        reset() noexcept
+        {
+            if (owner_) {
+                owner_->unhold_(*state_, buffer_);
+                owner_ = nullptr;
+            }
+        }
+
+        /**
+         * Get the held Buffer. Its data stays valid while the Hold exists.
+         */
+        Buffer
+        buffer() const noexcept
+        { return buffer_; }
+
+    private:
+        friend class Deferred_release;
+
+        Hold(Deferred_release* owner, std::atomic<uint32_t>* state, MMAL_BUFFER_HEADER_T* buffer) noexcept
+            : owner_(owner),
+              state_(state),
+              buffer_(buffer)
+        {}
+
+        Deferred_release* owner_;
+        std::atomic<uint32_t>* state_;
+        MMAL_BUFFER_HEADER_T* buffer_;
+
+    };
+
+    /// ctor. Attach to every Buffer of pool.
+    explicit Deferred_release(Pool pool)
+        : pool_(pool),
+          state_(new std::atomic<uint32_t>[pool.size()]),
+          deferred_(0)
+    {
+        for (std::size_t i = 0; i < pool.size(); ++i) {
+            state_[i].store(0, std::memory_order_relaxed);
+            index_.emplace(pool[uint32_t(i)].get(), i);
+        }
+        pool_.set_pre_release(&Deferred_release::pre_release_, this);
+    }
+
+    Deferred_release(const Deferred_release&) = delete;
+    Deferred_release& operator=(const Deferred_release&) = delete;
+
+    /// dtor. Detach from the Pool.
+    ~Deferred_release()
+    { pool_.set_pre_release(nullptr, nullptr); }
+
+    /**
+     * Hold a Buffer of the Pool. It must be called while the caller still owns a
+     * reference on the Buffer (e.g. in the port callback, before release()).
+     */
+    Hold
+    hold(const Buffer& buffer)
+    {
+        auto it = index_.find(buffer.get());
+        if (it == index_.end())
+            throw std::invalid_argument("Buffer doesn't belong to the Pool");
+        state_[it->second].fetch_add(1, std::memory_order_acq_rel);
+        return {this, &state_[it->second], buffer.get()};
+    }
+
+    /**
+     * Get how many times recycling has been postponed.
+     */
+    uint64_t
+    deferred() const
+    { return deferred_.load(std::memory_order_relaxed); }
+
+private:
+    Pool pool_;
+    std::unique_ptr<std::atomic<uint32_t>[]> state_;
+    std::unordered_map<MMAL_BUFFER_HEADER_T*, std::size_t> index_;
+    std::atomic<uint64_t> deferred_;
+
+    /// Pre-release callback: postpone recycling while the header is held.
+    static MMAL_BOOL_T
+    pre_release_(MMAL_BUFFER_HEADER_T* buffer, void* userdata)
+    {
+        auto* self = static_cast<Deferred_release*>(userdata);
+        auto it = self->index_.find(buffer);
+        if (it == self->index_.end())
+            return MMAL_FALSE;
+        std::atomic<uint32_t>& state = self->state_[it->second];
+        uint32_t s = state.load(std::memory_order_acquire);
+        while (s & holds_mask_)
+            if (state.compare_exchange_weak(s, s | deferred_flag_, std::memory_order_acq_rel)) {
+                self->deferred_.fetch_add(1, std::memory_order_relaxed);
+                return MMAL_TRUE;
+            }
+        return MMAL_FALSE;
+    }
+
+    /// Drop a hold and complete a postponed release if it was the last one.
+    void
+    unhold_(std::atomic<uint32_t>& state, MMAL_BUFFER_HEADER_T* buffer) noexcept
+    {
+        const uint32_t prev = state.fetch_sub(1, std::memory_order_acq_rel);
+        if ((prev & holds_mask_) == 1 && (prev & deferred_flag_)) {
+            state.store(0, std::memory_order_release);
+            mmalpp_impl_::buffer_header_continue_release_(buffer);
+        }
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_DEFERRED_RELEASE_H
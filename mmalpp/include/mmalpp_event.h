@@ -0,0 +1,154 @@
+#ifndef MMALPP_EVENT_H
+#define MMALPP_EVENT_H
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <variant>
+#include <vector>
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_events.h>
+#include <interface/mmal/mmal_format.h>
+#include <interface/mmal/mmal_parameters.h>
+
+#include "mmalpp_buffer.h"
+#include "utils/mmalpp_format_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// MMAL_EVENT_FORMAT_CHANGED: the format of an output port changed midstream
+/// (e.g. a decoder found a new resolution in the stream). The port must be
+/// reconfigured (see Generic_port::apply_format_change()) to go on.
+struct Format_changed_event {
+
+    /// Buffer requirements of the new format.
+    uint32_t buffer_num_min = 0;
+    uint32_t buffer_size_min = 0;
+    uint32_t buffer_num_recommended = 0;
+    uint32_t buffer_size_recommended = 0;
+
+    /// Copy of the new format, extradata included.
+    std::shared_ptr<MMAL_ES_FORMAT_T> format;
+
+};
+
+/// MMAL_EVENT_PARAMETER_CHANGED: a parameter asked for with
+/// MMAL_PARAMETER_CHANGE_EVENT_REQUEST changed (e.g. the camera settings).
+struct Parameter_changed_event {
+
+    /// Id of the parameter.
+    uint32_t id = 0;
+
+    /// Copy of the whole parameter structure, header first.
+    std::vector<uint8_t> data;
+
+    /**
+     * Get the parameter header.
+     */
+    const MMAL_PARAMETER_HEADER_T*
+    header() const
+    { return reinterpret_cast<const MMAL_PARAMETER_HEADER_T*>(data.data()); }
+
+    /**
+     * Get the parameter as its own structure (e.g. MMAL_PARAMETER_CAMERA_SETTINGS_T).
+     * It returns nullptr if the event is smaller than T.
+     */
+    template <typename T>
+    const T*
+    as() const
+    { return data.size() >= sizeof(T) ? reinterpret_cast<const T*>(data.data()) : nullptr; }
+
+};
+
+/// MMAL_EVENT_EOS: a port reached the end of the stream.
+struct Eos_event {
+
+    MMAL_PORT_TYPE_T port_type = MMAL_PORT_TYPE_UNKNOWN;
+    uint32_t port_index = 0;
+
+};
+
+/// MMAL_EVENT_ERROR: the component hit an error it can't recover from.
+struct Error_event {
+
+    MMAL_STATUS_T status = MMAL_EINVAL;
+
+};
+
+/// Any other event.
+struct Unknown_event {
+
+    /// The MMAL_EVENT_* four character code.
+    uint32_t cmd = 0;
+
+};
+
+/// An event sent by a component, decoded from its buffer header. Use std::visit
+/// or std::get_if to read it.
+using Event = std::variant<Format_changed_event,
+                           Parameter_changed_event,
+                           Eos_event,
+                           Error_event,
+                           Unknown_event>;
+
+/**
+ * Decode the event carried by a Buffer (its command is not 0). The Event copies
+ * what it needs, so the Buffer can be released right after.
+ */
+inline Event
+parse_event(const Buffer& buffer)
+{
+    MMAL_BUFFER_HEADER_T* b = buffer.get();
+    const uint8_t* data = b->data + b->offset;
+
+    switch (b->cmd) {
+    case MMAL_EVENT_FORMAT_CHANGED: {
+        const MMAL_EVENT_FORMAT_CHANGED_T* f = mmal_event_format_changed_get(b);
+        if (!f)
+            break;
+        Format_changed_event e;
+        e.buffer_num_min = f->buffer_num_min;
+        e.buffer_size_min = f->buffer_size_min;
+        e.buffer_num_recommended = f->buffer_num_recommended;
+        e.buffer_size_recommended = f->buffer_size_recommended;
+        e.format.reset(mmalpp_impl_::alloc_format_(), &mmalpp_impl_::free_format_);
+        mmalpp_impl_::full_copy_format_(f->format, e.format.get());
+        return e;
+    }
+    case MMAL_EVENT_PARAMETER_CHANGED: {
+        if (b->length < sizeof(MMAL_PARAMETER_HEADER_T))
+            break;
+        const MMAL_PARAMETER_HEADER_T* hdr = reinterpret_cast<const MMAL_PARAMETER_HEADER_T*>(data);
+        Parameter_changed_event e;
+        e.id = hdr->id;
+        e.data.assign(data, data + std::min<uint32_t>(hdr->size, b->length));
+        return e;
+    }
+    case MMAL_EVENT_EOS: {
+        Eos_event e;
+        if (b->length >= sizeof(MMAL_EVENT_END_OF_STREAM_T)) {
+            MMAL_EVENT_END_OF_STREAM_T eos;
+            std::memcpy(&eos, data, sizeof(eos));
+            e.port_type = eos.port_type;
+            e.port_index = eos.port_index;
+        }
+        return e;
+    }
+    case MMAL_EVENT_ERROR: {
+        Error_event e;
+        if (b->length >= sizeof(MMAL_STATUS_T))
+            std::memcpy(&e.status, data, sizeof(MMAL_STATUS_T));
+        return e;
+    }
+    default:
+        break;
+    }
+    return Unknown_event{b->cmd};
+}
+
+MMALPP_END
+
+#endif // MMALPP_EVENT_H
@@ -0,0 +1,139 @@
+#ifndef MMALPP_EXECUTOR_H
+#define MMALPP_EXECUTOR_H
+
+/// Coroutine support (co_await on ports and queues) needs C++20.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define MMALPP_HAS_COROUTINES 1
+#endif
+
+#ifdef MMALPP_HAS_COROUTINES
+
+#include <condition_variable>
+#include <coroutine>
+#include <deque>
+#include <mutex>
+
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Where coroutines waiting on the library (Generic_port::next_buffer(),
+/// Queue::next_buffer(), ...) are resumed. post() is called from the thread
+/// which completes the wait, often the MMAL callback thread: it must not block.
+class Executor {
+
+public:
+
+    virtual ~Executor() = default;
+
+    /**
+     * Run the coroutine, now or later, on a thread of the executor.
+     */
+    virtual void
+    post(std::coroutine_handle<> coroutine) = 0;
+
+};
+
+/// Executor resuming coroutines right away, on the thread which completes the
+/// wait. It is the default: the coroutine then runs on the MMAL callback thread,
+/// so it must be as quick as a port callback.
+class Inline_executor final : public Executor {
+
+public:
+
+    void
+    post(std::coroutine_handle<> coroutine) override
+    { coroutine.resume(); }
+
+    /**
+     * Get the shared instance.
+     */
+    static Inline_executor&
+    instance()
+    {
+        static Inline_executor executor;
+        return executor;
+    }
+
+};
+
+/// Executor resuming coroutines on the threads calling run(), one at a time in
+/// post order, e.g. one or two threads for many camera or encoder sessions.
+class Loop_executor final : public Executor {
+
+public:
+
+    void
+    post(std::coroutine_handle<> coroutine) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ready_.push_back(coroutine);
+        }
+        cv_.notify_one();
+    }
+
+    /**
+     * Resume coroutines until stop() is called.
+     */
+    void
+    run()
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        for (;;) {
+            cv_.wait(lock, [this] { return stopped_ || !ready_.empty(); });
+            if (stopped_)
+                return;
+            std::coroutine_handle<> coroutine = ready_.front();
+            ready_.pop_front();
+            lock.unlock();
+            coroutine.resume();
+            lock.lock();
+        }
+    }
+
+    /**
+     * Resume the coroutines ready now, without waiting. Return how many ran.
+     */
+    std::size_t
+    poll()
+    {
+        std::size_t n = 0;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (!ready_.empty()) {
+            std::coroutine_handle<> coroutine = ready_.front();
+            ready_.pop_front();
+            lock.unlock();
+            coroutine.resume();
+            ++n;
+            lock.lock();
+        }
+        return n;
+    }
+
+    /**
+     * Make run() return.
+     */
+    void
+    stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopped_ = true;
+        }
+        cv_.notify_all();
+    }
+
+private:
+    std::mutex mutex_;
+    std::condition_variable cv_;
+    std::deque<std::coroutine_handle<>> ready_;
+    bool stopped_ = false;
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_HAS_COROUTINES
+
+#endif // MMALPP_EXECUTOR_H
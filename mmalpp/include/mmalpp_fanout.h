@@ -0,0 +1,187 @@
+#ifndef MMALPP_FANOUT_H
+#define MMALPP_FANOUT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <interface/mmal/mmal_buffer.h>
+
+#include "mmalpp_buffer.h"
+#include "mmalpp_pool.h"
+#include "mmalpp_port.h"
+#include "mmalpp_connection.h"
+#include "utils/mmalpp_buffer_utils.h"
+#include "utils/mmalpp_callback_utils.h"
+#include "utils/mmalpp_queue_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Delivery counters of a Fanout consumer (see Fanout::metrics()).
+struct Fanout_metrics {
+
+    /// Replicas handed to the consumer.
+    uint64_t delivered = 0;
+
+    /// Buffers the consumer missed because it already held max_lag replicas.
+    uint64_t dropped = 0;
+
+    /// Replicas the consumer holds now, and the highest number seen so far.
+    std::size_t lag = 0;
+    std::size_t max_lag = 0;
+
+};
+
+/// Delivery of every Buffer of an output port to several consumers (e.g. a
+/// recorder, a motion detector and a preview streamer) without copying the
+/// payload. Each consumer gets a replica of the Buffer header, which shares the
+/// payload and holds a reference to the original: the original goes back to the
+/// port only when every consumer has released its replica.
+/// Replica headers come from a Pool of max_lag headers per consumer, so a slow
+/// consumer can hold at most max_lag frames: beyond that it misses Buffers (they
+/// are counted as dropped) and the others don't stall.
+/// Consumers are called in order on the port callback thread with a
+/// Unique_buffer: they can keep it (e.g. put it in a Spsc_queue) for as long as
+/// they need. The Fanout must outlive the replicas and the enabled port.
+class Fanout {
+
+public:
+
+    /// ctor.
+    Fanout() = default;
+
+    Fanout(const Fanout&) = delete;
+    Fanout& operator=(const Fanout&) = delete;
+
+    /**
+     * Add a consumer and return its index. The callback takes a Unique_buffer
+     * (the replica); exceptions it throws are swallowed. Consumers must be added
+     * before attach().
+     */
+    template <typename F_>
+    std::size_t
+    add_consumer(F_&& callback, std::size_t max_lag = 4)
+    {
+        if (!max_lag)
+            throw std::invalid_argument("a consumer needs at least one replica");
+        auto consumer = std::make_unique<Consumer_>(max_lag);
+        consumer->callback_.emplace(std::forward<F_>(callback));
+        consumer->invoke_ = &invoke_<std::decay_t<F_>>;
+        consumers_.push_back(std::move(consumer));
+        return consumers_.size() - 1;
+    }
+
+    /**
+     * Enable an output port with the Fanout as its callback. Originals released
+     * by the consumers are sent straight back to the port (see Pool::recycle_to()),
+     * and the port gets every Buffer of its Pool now.
+     */
+    void
+    attach(Generic_port& port)
+    {
+        Pool pool = port.pool();
+        if (pool.is_null())
+            throw std::logic_error("the port needs a Pool to fan out");
+        pool.recycle_to(port.get());
+        port.enable([this] (Generic_port&, Unique_buffer buffer) { dispatch(*buffer); });
+        port.send_all_buffers();
+    }
+
+    /**
+     * Hand a replica of buffer to every consumer. attach() calls it for every
+     * Buffer of the port; it can be called from any other callback too, but from
+     * one thread at a time. The caller keeps its reference to buffer.
+     */
+    void
+    dispatch(const Buffer& buffer)
+    {
+        for (const std::unique_ptr<Consumer_>& consumer : consumers_)
+            consumer->deliver(buffer);
+    }
+
+    /**
+     * Get the number of consumers.
+     */
+    std::size_t
+    size() const
+    { return consumers_.size(); }
+
+    /**
+     * Get the delivery counters of the consumer at index.
+     */
+    Fanout_metrics
+    metrics(std::size_t index) const
+    {
+        const Consumer_& c = *consumers_.at(index);
+        Fanout_metrics m;
+        m.delivered = c.delivered_.load(std::memory_order_relaxed);
+        m.dropped = c.dropped_.load(std::memory_order_relaxed);
+        m.lag = c.lag();
+        m.max_lag = c.max_lag_seen_.load(std::memory_order_relaxed);
+        return m;
+    }
+
+private:
+    /// A consumer, with the Pool of its replica headers.
+    struct Consumer_ {
+        mmalpp_impl_::Callback_storage_ callback_;
+        void (*invoke_)(mmalpp_impl_::Callback_storage_&, Unique_buffer) = nullptr;
+        Pool replicas_;
+        std::atomic<uint64_t> delivered_{0};
+        std::atomic<uint64_t> dropped_{0};
+        std::atomic<std::size_t> max_lag_seen_{0};
+
+        explicit Consumer_(std::size_t max_lag)
+            : replicas_(max_lag, 0)
+        {}
+
+        ~Consumer_()
+        { replicas_.release(); }
+
+        std::size_t
+        lag() const
+        {
+            const MMAL_POOL_T* pool = replicas_.get();
+            return pool->headers_num - mmalpp_impl_::get_queue_lenght_(pool->queue);
+        }
+
+        void
+        deliver(const Buffer& buffer)
+        {
+            MMAL_BUFFER_HEADER_T* replica = mmalpp_impl_::get_buffer_from_queue_no_time_(replicas_.get()->queue);
+            if (!replica) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            if (mmal_buffer_header_replicate(replica, buffer.get()) != MMAL_SUCCESS) {
+                mmalpp_impl_::release_buffer_header_(replica);
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            delivered_.fetch_add(1, std::memory_order_relaxed);
+            const std::size_t held = lag();
+            if (held > max_lag_seen_.load(std::memory_order_relaxed))
+                max_lag_seen_.store(held, std::memory_order_relaxed);
+            try {
+                invoke_(callback_, Unique_buffer(replica));
+            } catch (...) {}
+        }
+    };
+
+    std::vector<std::unique_ptr<Consumer_>> consumers_;
+
+    template <typename F_>
+    static void
+    invoke_(mmalpp_impl_::Callback_storage_& storage, Unique_buffer replica)
+    { storage.get<F_>()(std::move(replica)); }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_FANOUT_H
@@ -0,0 +1,214 @@
+#ifndef MMALPP_FORMAT_H
+#define MMALPP_FORMAT_H
+
+#include <stdexcept>
+
+#include <interface/vcos/vcos.h>
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_format.h>
+#include <interface/mmal/mmal_encodings.h>
+
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Builder of a video port format. It applies the MMAL alignment rules (the
+/// frame width is aligned up to 32 and the height up to 16, the visible region
+/// is kept in the crop rectangle) and checks the values while they are set.
+/// Every function is constexpr: a format built in a constant expression is
+/// validated at compile time, e.g.
+///     constexpr auto hd = mmalpp::Video_format(1920, 1080).frame_rate(30, 1);
+/// doesn't compile if a value is wrong. Otherwise it throws std::invalid_argument.
+class Video_format {
+
+public:
+
+    static constexpr uint32_t width_alignment = 32;
+    static constexpr uint32_t height_alignment = 16;
+
+    /// ctor. width and height are the visible size in pixels.
+    constexpr Video_format(uint32_t width,
+                           uint32_t height,
+                           MMAL_FOURCC_T encoding = MMAL_ENCODING_I420)
+        : encoding_(encoding),
+          width_(align_(check_size_(width), width_alignment)),
+          height_(align_(check_size_(height), height_alignment)),
+          crop_{0, 0, int32_t(width), int32_t(height)}
+    { check_subsampling_(); }
+
+    /**
+     * Set the encoding.
+     */
+    constexpr Video_format&
+    encoding(MMAL_FOURCC_T encoding)
+    {
+        encoding_ = encoding;
+        check_subsampling_();
+        return *this;
+    }
+
+    /**
+     * Set the encoding variant.
+     */
+    constexpr Video_format&
+    encoding_variant(MMAL_FOURCC_T variant)
+    {
+        encoding_variant_ = variant;
+        return *this;
+    }
+
+    /**
+     * Set the visible region. It must lie inside the frame.
+     */
+    constexpr Video_format&
+    crop(int32_t x, int32_t y, int32_t width, int32_t height)
+    {
+        if (x < 0 || y < 0 || width <= 0 || height <= 0
+                || uint32_t(x + width) > width_ || uint32_t(y + height) > height_)
+            throw std::invalid_argument("crop rectangle out of the frame");
+        crop_ = {x, y, width, height};
+        check_subsampling_();
+        return *this;
+    }
+
+    /**
+     * Set the frame rate as num / den frames per second (0 / 1 means variable).
+     */
+    constexpr Video_format&
+    frame_rate(int32_t num, int32_t den = 1)
+    {
+        if (num < 0 || den <= 0)
+            throw std::invalid_argument("invalid frame rate");
+        frame_rate_ = {num, den};
+        return *this;
+    }
+
+    /**
+     * Set the pixel aspect ratio.
+     */
+    constexpr Video_format&
+    pixel_aspect_ratio(int32_t num, int32_t den)
+    {
+        if (num <= 0 || den <= 0)
+            throw std::invalid_argument("invalid pixel aspect ratio");
+        par_ = {num, den};
+        return *this;
+    }
+
+    /**
+     * Set the color space.
+     */
+    constexpr Video_format&
+    color_space(MMAL_FOURCC_T color_space)
+    {
+        color_space_ = color_space;
+        return *this;
+    }
+
+    /**
+     * Set the bitrate (for encoded formats).
+     */
+    constexpr Video_format&
+    bitrate(uint32_t bitrate)
+    {
+        bitrate_ = bitrate;
+        return *this;
+    }
+
+    /**
+     * Get the encoding.
+     */
+    constexpr MMAL_FOURCC_T
+    encoding() const
+    { return encoding_; }
+
+    /**
+     * Get the aligned frame width.
+     */
+    constexpr uint32_t
+    width() const
+    { return width_; }
+
+    /**
+     * Get the aligned frame height.
+     */
+    constexpr uint32_t
+    height() const
+    { return height_; }
+
+    /**
+     * Get the visible region.
+     */
+    constexpr MMAL_RECT_T
+    crop() const
+    { return crop_; }
+
+    /**
+     * Get the frame rate.
+     */
+    constexpr MMAL_RATIONAL_T
+    frame_rate() const
+    { return frame_rate_; }
+
+    /**
+     * Write this format into a MMAL format structure (e.g. port.format()).
+     * Fields which the builder doesn't know are left untouched.
+     */
+    void
+    apply_to(MMAL_ES_FORMAT_T* format) const
+    {
+        format->type = MMAL_ES_TYPE_VIDEO;
+        format->encoding = encoding_;
+        format->encoding_variant = encoding_variant_;
+        format->bitrate = bitrate_;
+        MMAL_VIDEO_FORMAT_T& video = format->es->video;
+        video.width = width_;
+        video.height = height_;
+        video.crop = crop_;
+        video.frame_rate = frame_rate_;
+        video.par = par_;
+        video.color_space = color_space_;
+    }
+
+private:
+    MMAL_FOURCC_T encoding_;
+    MMAL_FOURCC_T encoding_variant_ = 0;
+    uint32_t width_;
+    uint32_t height_;
+    MMAL_RECT_T crop_;
+    MMAL_RATIONAL_T frame_rate_ = {0, 1};
+    MMAL_RATIONAL_T par_ = {1, 1};
+    MMAL_FOURCC_T color_space_ = 0;
+    uint32_t bitrate_ = 0;
+
+    static constexpr uint32_t
+    check_size_(uint32_t size)
+    {
+        /// Larger than any VideoCore surface, it also keeps the alignment from overflowing.
+        if (size == 0 || size > 16384)
+            throw std::invalid_argument("invalid frame size");
+        return size;
+    }
+
+    static constexpr uint32_t
+    align_(uint32_t size, uint32_t alignment)
+    { return uint32_t(VCOS_ALIGN_UP(size, alignment)); }
+
+    /// Chroma subsampled encodings need an even visible region.
+    constexpr void
+    check_subsampling_() const
+    {
+        const bool subsampled = (encoding_ == MMAL_ENCODING_I420 || encoding_ == MMAL_ENCODING_NV12
+                                 || encoding_ == MMAL_ENCODING_YUYV);
+        const bool vertical = (encoding_ != MMAL_ENCODING_YUYV);
+        if (subsampled && ((crop_.x | crop_.width) & 1))
+            throw std::invalid_argument("odd horizontal crop for a subsampled encoding");
+        if (subsampled && vertical && ((crop_.y | crop_.height) & 1))
+            throw std::invalid_argument("odd vertical crop for a subsampled encoding");
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_FORMAT_H
@@ -0,0 +1,346 @@
+#ifndef MMALPP_FRAME_H
+#define MMALPP_FRAME_H
+
+#include <algorithm>
+#include <cstddef>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_format.h>
+#include <interface/mmal/mmal_encodings.h>
+
+#include "mmalpp_buffer.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Pixel types of packed planes.
+struct Uv    { uint8_t u, v; };
+struct Yuyv  { uint8_t y0, u, y1, v; };
+struct Rgb24 { uint8_t r, g, b; };
+struct Bgr24 { uint8_t b, g, r; };
+struct Rgba  { uint8_t r, g, b, a; };
+struct Bgra  { uint8_t b, g, r, a; };
+
+/// A plane of an image. Width is in elements of T, stride is in bytes.
+template <typename T>
+struct Plane {
+
+    T* data;
+    uint32_t width;
+    uint32_t height;
+    uint32_t stride;
+
+    /**
+     * Get a pointer to the first element of row y.
+     * This function doesn't check bounds.
+     */
+    T*
+    row(uint32_t y) const
+    {
+        using byte_ = std::conditional_t<std::is_const<T>::value, const uint8_t, uint8_t>;
+        return reinterpret_cast<T*>(reinterpret_cast<byte_*>(data) + std::size_t(y) * stride);
+    }
+
+    /**
+     * Get the element at (x, y). This function doesn't check bounds.
+     */
+    T&
+    at(uint32_t x, uint32_t y) const
+    { return row(y)[x]; }
+
+};
+
+/// Zero-copy view of a raw video frame stored in a Buffer. It computes the
+/// planes layout from the encoding, the (aligned) width and height and the
+/// crop rectangle of the format, so that every plane points directly into the
+/// buffer memory shared with VideoCore.
+/// Supported encodings: I420, NV12, YUYV, RGB24, BGR24, RGBA, BGRA.
+/// T_ is the byte type of the planes: a view of a const Buffer (e.g. in an
+/// auto recycle callback) or of const data is a Frame_view<const uint8_t>,
+/// whose planes are read-only. The template argument is deduced, so
+/// Frame_view view(buffer, port.format()) works in both cases.
+template <typename T_ = uint8_t>
+class Frame_view {
+
+    /// Element type U of a plane, const if the view is read-only.
+    template <typename U>
+    using element_ = std::conditional_t<std::is_const<T_>::value, const U, U>;
+
+    /// Buffer type the view is built from.
+    using buffer_ = std::conditional_t<std::is_const<T_>::value, const Buffer, Buffer>;
+
+    template <typename> friend class Frame_view;
+
+public:
+
+    static constexpr std::size_t max_planes = 3;
+
+    /// ctor. Build a view of buffer using the video format of the port
+    /// which produced it (e.g. port.format()).
+    Frame_view(buffer_& buffer,
+               const MMAL_ES_FORMAT_T* format)
+        : Frame_view(buffer.payload().data(),
+                     format->encoding,
+                     format->es->video.width,
+                     format->es->video.height,
+                     format->es->video.crop)
+    {
+        const MMAL_BUFFER_HEADER_TYPE_SPECIFIC_T* type = buffer.get()->type;
+        if (type && type->video.planes == planes_num_) {
+            /// VideoCore filled the planes layout, it wins over the computed one.
+            for (std::size_t i = 0; i < planes_num_; ++i)
+                set_plane_(i, buffer.payload().data() + type->video.offset[i], type->video.pitch[i]);
+            size_ = type->video.offset[planes_num_ - 1]
+                    + std::size_t(type->video.pitch[planes_num_ - 1]) * rows_(planes_num_ - 1);
+        }
+        if (buffer.payload().size() < size_)
+            throw std::length_error("Buffer too small for the frame format. "
+                                    "Actual: " + std::to_string(buffer.payload().size()) +
+                                    " Required: " + std::to_string(size_));
+    }
+
+    /// ctor. Build a view of a frame of the given encoding stored in data.
+    /// width and height are the aligned dimensions of the frame (the luma stride
+    /// in pixels and the number of rows), crop is the visible region.
+    /// If crop width or height is 0 the whole frame is visible.
+    Frame_view(T_* data,
+               MMAL_FOURCC_T encoding,
+               uint32_t width,
+               uint32_t height,
+               MMAL_RECT_T crop = {0, 0, 0, 0})
+        : encoding_(encoding),
+          height_(height),
+          crop_(crop)
+    {
+        if (crop_.width <= 0 || crop_.height <= 0)
+            crop_ = {0, 0, int32_t(width), int32_t(height)};
+        if (crop_.x < 0 || crop_.y < 0
+                || uint32_t(crop_.x + crop_.width) > width
+                || uint32_t(crop_.y + crop_.height) > height)
+            throw std::invalid_argument("crop rectangle out of the frame");
+
+        switch (encoding) {
+        case MMAL_ENCODING_I420:
+            set_layout_({{1, 1, 1}, {2, 2, 1}, {2, 2, 1}}, 3);
+            set_plane_(0, data, width);
+            set_plane_(1, base_[0] + std::size_t(width) * rows_(0), width / 2);
+            set_plane_(2, base_[1] + std::size_t(width / 2) * rows_(1), width / 2);
+            break;
+        case MMAL_ENCODING_NV12:
+            set_layout_({{1, 1, 1}, {2, 2, 2}}, 2);
+            set_plane_(0, data, width);
+            set_plane_(1, base_[0] + std::size_t(width) * rows_(0), width);
+            break;
+        case MMAL_ENCODING_YUYV:
+            set_layout_({{2, 1, 4}}, 1);
+            set_plane_(0, data, width * 2);
+            break;
+        case MMAL_ENCODING_RGB24:
+        case MMAL_ENCODING_BGR24:
+            set_layout_({{1, 1, 3}}, 1);
+            set_plane_(0, data, width * 3);
+            break;
+        case MMAL_ENCODING_RGBA:
+        case MMAL_ENCODING_BGRA:
+            set_layout_({{1, 1, 4}}, 1);
+            set_plane_(0, data, width * 4);
+            break;
+        default:
+            throw std::invalid_argument("encoding not supported by Frame_view");
+        }
+        const std::size_t last = planes_num_ - 1;
+        size_ = std::size_t(base_[last] - data) + std::size_t(planes_[last].stride) * rows_(last);
+    }
+
+    /// ctor. A read-only view of a writable one.
+    template <typename U_, typename = std::enable_if_t<std::is_same<T_, const U_>::value>>
+    Frame_view(const Frame_view<U_>& view)
+        : encoding_(view.encoding_),
+          height_(view.height_),
+          crop_(view.crop_),
+          planes_num_(view.planes_num_),
+          size_(view.size_)
+    {
+        for (std::size_t i = 0; i < max_planes; ++i) {
+            layout_[i] = {view.layout_[i].sub_x, view.layout_[i].sub_y, view.layout_[i].bytes};
+            base_[i] = view.base_[i];
+            const Plane<U_>& p = view.planes_[i];
+            planes_[i] = {p.data, p.width, p.height, p.stride};
+        }
+    }
+
+    /**
+     * Get the encoding of the frame.
+     */
+    MMAL_FOURCC_T
+    encoding() const
+    { return encoding_; }
+
+    /**
+     * Get the visible width in pixels.
+     */
+    uint32_t
+    width() const
+    { return uint32_t(crop_.width); }
+
+    /**
+     * Get the visible height in pixels.
+     */
+    uint32_t
+    height() const
+    { return uint32_t(crop_.height); }
+
+    /**
+     * Get the number of planes.
+     */
+    std::size_t
+    planes() const
+    { return planes_num_; }
+
+    /**
+     * Get the n-th plane as raw bytes (width is in bytes).
+     * This function doesn't check bounds.
+     */
+    Plane<T_>
+    plane(std::size_t n) const
+    { return planes_[n]; }
+
+    /**
+     * Get the luma plane of a planar frame (I420, NV12).
+     */
+    Plane<T_>
+    y() const
+    { return typed_<uint8_t>(0, MMAL_ENCODING_I420, MMAL_ENCODING_NV12); }
+
+    /**
+     * Get the U plane of an I420 frame.
+     */
+    Plane<T_>
+    u() const
+    { return typed_<uint8_t>(1, MMAL_ENCODING_I420); }
+
+    /**
+     * Get the V plane of an I420 frame.
+     */
+    Plane<T_>
+    v() const
+    { return typed_<uint8_t>(2, MMAL_ENCODING_I420); }
+
+    /**
+     * Get the interleaved chroma plane of a NV12 frame.
+     */
+    Plane<element_<Uv>>
+    uv() const
+    { return typed_<Uv>(1, MMAL_ENCODING_NV12); }
+
+    /**
+     * Get the packed plane of a YUYV frame. Every element holds two pixels.
+     */
+    Plane<element_<Yuyv>>
+    yuyv() const
+    { return typed_<Yuyv>(0, MMAL_ENCODING_YUYV); }
+
+    /**
+     * Get the packed plane of a RGB24 frame.
+     */
+    Plane<element_<Rgb24>>
+    rgb24() const
+    { return typed_<Rgb24>(0, MMAL_ENCODING_RGB24); }
+
+    /**
+     * Get the packed plane of a BGR24 frame.
+     */
+    Plane<element_<Bgr24>>
+    bgr24() const
+    { return typed_<Bgr24>(0, MMAL_ENCODING_BGR24); }
+
+    /**
+     * Get the packed plane of a RGBA frame.
+     */
+    Plane<element_<Rgba>>
+    rgba() const
+    { return typed_<Rgba>(0, MMAL_ENCODING_RGBA); }
+
+    /**
+     * Get the packed plane of a BGRA frame.
+     */
+    Plane<element_<Bgra>>
+    bgra() const
+    { return typed_<Bgra>(0, MMAL_ENCODING_BGRA); }
+
+    /**
+     * Get the minimum number of bytes needed to store the whole frame.
+     */
+    std::size_t
+    size() const
+    { return size_; }
+
+private:
+    /// Subsampling and bytes per element of a plane. An element covers
+    /// sub_x pixels horizontally (e.g. a YUYV macropixel or a NV12 U/V pair).
+    struct Layout_ {
+        uint32_t sub_x;
+        uint32_t sub_y;
+        uint32_t bytes;
+    };
+
+    MMAL_FOURCC_T encoding_;
+    uint32_t height_;
+    MMAL_RECT_T crop_;
+    std::size_t planes_num_ = 0;
+    std::size_t size_ = 0;
+    Layout_ layout_[max_planes] = {};
+    T_* base_[max_planes] = {};
+    Plane<T_> planes_[max_planes] = {};
+
+    /// Set the layout of the planes.
+    void
+    set_layout_(std::initializer_list<Layout_> layout, std::size_t n)
+    {
+        std::copy(layout.begin(), layout.end(), layout_);
+        planes_num_ = n;
+    }
+
+    /// Set the n-th plane. base points at the top-left of the whole plane,
+    /// the visible plane starts at the crop origin.
+    void
+    set_plane_(std::size_t n, T_* base, uint32_t stride)
+    {
+        const Layout_& l = layout_[n];
+        base_[n] = base;
+        planes_[n].data = base + std::size_t(uint32_t(crop_.y) / l.sub_y) * stride
+                               + std::size_t(uint32_t(crop_.x) / l.sub_x) * l.bytes;
+        planes_[n].width = (uint32_t(crop_.width) / l.sub_x) * l.bytes;
+        planes_[n].height = uint32_t(crop_.height) / l.sub_y;
+        planes_[n].stride = stride;
+    }
+
+    /// Number of rows of the n-th plane of the whole frame.
+    uint32_t
+    rows_(std::size_t n) const
+    { return height_ / layout_[n].sub_y; }
+
+    /// Get the n-th plane as a plane of T, checking the encoding.
+    template <typename T, typename... E_>
+    Plane<element_<T>>
+    typed_(std::size_t n, E_... encodings) const
+    {
+        if (((encoding_ != MMAL_FOURCC_T(encodings)) && ...))
+            throw std::logic_error("plane not available for this encoding");
+        const Plane<T_>& p = planes_[n];
+        return {reinterpret_cast<element_<T>*>(p.data), uint32_t(p.width / sizeof(T)), p.height, p.stride};
+    }
+
+};
+
+/// Deduction guides: a view of a const Buffer is read-only.
+Frame_view(Buffer&, const MMAL_ES_FORMAT_T*) -> Frame_view<uint8_t>;
+Frame_view(const Buffer&, const MMAL_ES_FORMAT_T*) -> Frame_view<const uint8_t>;
+
+MMALPP_END
+
+#endif // MMALPP_FRAME_H
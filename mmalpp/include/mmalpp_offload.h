@@ -0,0 +1,263 @@
+#ifndef MMALPP_OFFLOAD_H
+#define MMALPP_OFFLOAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <interface/mmal/mmal_buffer.h>
+
+#include "utils/mmalpp_ring_utils.h"
+#include "mmalpp_types.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Options of the offload mode of a port (see Generic_port::enable_offload).
+struct Offload_options {
+
+    /// Number of worker threads running the callback.
+    std::size_t workers = 1;
+
+    /// Number of buffer headers the ring can hold. Rounded up to a power of two.
+    std::size_t capacity = 16;
+
+    /// What to do when the ring is full.
+    OVERFLOW_POLICY overflow = DROP_OLDEST;
+
+};
+
+/// Queue metrics of a port in offload mode.
+struct Offload_metrics {
+
+    /// Buffer headers waiting in the ring.
+    std::size_t depth = 0;
+
+    /// Highest depth seen so far.
+    std::size_t max_depth = 0;
+
+    /// Capacity of the ring.
+    std::size_t capacity = 0;
+
+    /// Buffer headers received from MMAL.
+    uint64_t received = 0;
+
+    /// Buffer headers handed to the callback.
+    uint64_t processed = 0;
+
+    /// Buffer headers dropped because the ring was full.
+    uint64_t dropped = 0;
+
+    /// Times the MMAL callback thread had to wait for room (BLOCK policy).
+    uint64_t blocked = 0;
+
+};
+
+namespace mmalpp_impl_ {
+
+/**
+ * Dispatcher of the offload mode. The MMAL callback only pushes the buffer header
+ * into a lock-free ring, and a pool of workers pops it and runs the callback.
+ * Threads go to sleep on condition variables only when the ring is empty (workers)
+ * or full with the BLOCK policy (producer); the counters of sleeping threads are
+ * checked after a full fence, so the fast path never takes the mutex.
+ */
+class Offload_ {
+
+public:
+
+    /// Function running the callback, or recycling a dropped buffer header.
+    using handler_type_ = void (*)(void*, MMAL_BUFFER_HEADER_T*);
+
+    /// ctor. Start the workers.
+    Offload_(const Offload_options& options,
+             handler_type_ run,
+             handler_type_ drop,
+             void* context)
+        : ring_(options.capacity),
+          policy_(options.overflow),
+          workers_num_(std::max<std::size_t>(options.workers, 1)),
+          run_(run),
+          drop_(drop),
+          context_(context)
+    { start(); }
+
+    Offload_(const Offload_&) = delete;
+    Offload_& operator=(const Offload_&) = delete;
+
+    /// dtor. Stop the workers.
+    ~Offload_()
+    { stop(); }
+
+    /**
+     * Queue a buffer header. Called on the MMAL callback thread.
+     */
+    void
+    push(MMAL_BUFFER_HEADER_T* buffer)
+    {
+        received_.fetch_add(1, std::memory_order_relaxed);
+        while (!ring_.try_push(buffer)) {
+            if (policy_ == DROP_NEWEST) {
+                dropped_.fetch_add(1, std::memory_order_relaxed);
+                drop_(context_, buffer);
+                return;
+            }
+            if (policy_ == DROP_OLDEST) {
+                MMAL_BUFFER_HEADER_T* oldest;
+                if (ring_.try_pop(oldest)) {
+                    dropped_.fetch_add(1, std::memory_order_relaxed);
+                    drop_(context_, oldest);
+                }
+                continue;
+            }
+            if (wait_for_room_(buffer))
+                break;
+        }
+        update_max_depth_(ring_.size());
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            work_cv_.notify_one();
+        }
+    }
+
+    /**
+     * Start the workers, if they are not running.
+     */
+    void
+    start()
+    {
+        if (!workers_.empty())
+            return;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = false;
+        }
+        workers_.reserve(workers_num_);
+        for (std::size_t i = 0; i < workers_num_; ++i)
+            workers_.emplace_back([this] { work_(); });
+    }
+
+    /**
+     * Stop the workers once they have run the callback on every queued buffer header.
+     */
+    void
+    stop()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_cv_.notify_all();
+        for (std::thread& t : workers_)
+            if (t.joinable())
+                t.join();
+        workers_.clear();
+    }
+
+    /**
+     * Get the queue metrics.
+     */
+    Offload_metrics
+    metrics() const
+    {
+        Offload_metrics m;
+        m.depth = ring_.size();
+        m.max_depth = max_depth_.load(std::memory_order_relaxed);
+        m.capacity = ring_.capacity();
+        m.received = received_.load(std::memory_order_relaxed);
+        m.processed = processed_.load(std::memory_order_relaxed);
+        m.dropped = dropped_.load(std::memory_order_relaxed);
+        m.blocked = blocked_.load(std::memory_order_relaxed);
+        return m;
+    }
+
+private:
+    Mpmc_ring_<MMAL_BUFFER_HEADER_T*> ring_;
+    const OVERFLOW_POLICY policy_;
+    const std::size_t workers_num_;
+    const handler_type_ run_;
+    const handler_type_ drop_;
+    void* const context_;
+
+    std::vector<std::thread> workers_;
+    std::mutex mutex_;
+    std::condition_variable work_cv_;
+    std::condition_variable room_cv_;
+    bool stopping_ = false;
+    std::atomic<uint32_t> idle_{0};
+    std::atomic<uint32_t> waiting_{0};
+
+    std::atomic<std::size_t> max_depth_{0};
+    std::atomic<uint64_t> received_{0};
+    std::atomic<uint64_t> processed_{0};
+    std::atomic<uint64_t> dropped_{0};
+    std::atomic<uint64_t> blocked_{0};
+
+    /// Wait until buffer fits in the ring. Return true once it has been pushed.
+    bool
+    wait_for_room_(MMAL_BUFFER_HEADER_T* buffer)
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        waiting_.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const bool pushed = ring_.try_push(buffer);
+        if (!pushed) {
+            blocked_.fetch_add(1, std::memory_order_relaxed);
+            room_cv_.wait(lock);
+        }
+        waiting_.fetch_sub(1, std::memory_order_relaxed);
+        return pushed;
+    }
+
+    /// Worker loop.
+    void
+    work_()
+    {
+        for (;;) {
+            MMAL_BUFFER_HEADER_T* buffer;
+            if (!ring_.try_pop(buffer)) {
+                std::unique_lock<std::mutex> lock(mutex_);
+                idle_.fetch_add(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                while (!ring_.try_pop(buffer)) {
+                    if (stopping_) {
+                        idle_.fetch_sub(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    work_cv_.wait(lock);
+                }
+                idle_.fetch_sub(1, std::memory_order_relaxed);
+            }
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (waiting_.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                room_cv_.notify_all();
+            }
+
+            run_(context_, buffer);
+            processed_.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    void
+    update_max_depth_(std::size_t depth)
+    {
+        std::size_t max = max_depth_.load(std::memory_order_relaxed);
+        while (depth > max && !max_depth_.compare_exchange_weak(max, depth, std::memory_order_relaxed))
+        {}
+    }
+
+};
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_OFFLOAD_H
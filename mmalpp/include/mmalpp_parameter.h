@@ -0,0 +1,337 @@
+#ifndef MMALPP_PARAMETER_H
+#define MMALPP_PARAMETER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_port.h>
+#include <interface/mmal/mmal_parameters.h>
+
+#include "utils/mmalpp_port_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/// Parameters of a port as last applied to VideoCore, and the ones staged by
+/// an open transaction. Every parameter is stored as its whole structure
+/// (header included), so any two values of the same id compare with memcmp.
+struct Parameter_cache_ {
+
+    std::mutex mutex_;
+    std::unordered_map<uint32_t, std::vector<uint8_t>> applied_;
+    std::vector<std::vector<uint8_t>> staged_;
+    unsigned int depth_ = 0;
+    std::atomic<uint64_t> saved_{0};
+
+};
+
+};
+
+/// This class is used to set and get parameters of ports. When it is obtained
+/// from a port, it shares the parameter cache of the port: between begin() and
+/// commit() the values are staged and applied together on commit().
+/// Skipping is opt-in: a cached Parameter (Generic_port::cached_parameter())
+/// doesn't send a value identical to the last one applied, so no IPC round trip
+/// to VideoCore is made. Trigger parameters (e.g. MMAL_PARAMETER_CAPTURE) are
+/// never skipped, since setting them again has an effect.
+/// The cache only knows the values set or got through this class: call
+/// invalidate() if they may have been changed elsewhere (e.g. by a component reset).
+class Parameter {
+public:
+
+    /// ctor.
+    Parameter(MMAL_PORT_T* port,
+              mmalpp_impl_::Parameter_cache_* cache = nullptr,
+              bool cached = false)
+        : port_(port),
+          cache_(cache),
+          cached_(cache && cached)
+    {}
+
+    void
+    set_header(MMAL_PARAMETER_HEADER_T* hdr)
+    { set_(hdr); }
+
+    void
+    set_boolean(uint32_t id, bool value)
+    {
+        MMAL_PARAMETER_BOOLEAN_T p = make_<MMAL_PARAMETER_BOOLEAN_T>(id);
+        p.enable = value;
+        set_(&p.hdr);
+    }
+
+    void
+    set_int64(uint32_t id, int64_t value)
+    {
+        MMAL_PARAMETER_INT64_T p = make_<MMAL_PARAMETER_INT64_T>(id, value);
+        set_(&p.hdr);
+    }
+
+    void
+    set_uint64(uint32_t id, uint64_t value)
+    {
+        MMAL_PARAMETER_UINT64_T p = make_<MMAL_PARAMETER_UINT64_T>(id, value);
+        set_(&p.hdr);
+    }
+
+    void
+    set_int32(uint32_t id, int32_t value)
+    {
+        MMAL_PARAMETER_INT32_T p = make_<MMAL_PARAMETER_INT32_T>(id, value);
+        set_(&p.hdr);
+    }
+
+    void
+    set_uint32(uint32_t id, uint32_t value)
+    {
+        MMAL_PARAMETER_UINT32_T p = make_<MMAL_PARAMETER_UINT32_T>(id, value);
+        set_(&p.hdr);
+    }
+
+    void
+    set_rational(uint32_t id, int32_t num, int32_t den)
+    {
+        MMAL_PARAMETER_RATIONAL_T p = make_<MMAL_PARAMETER_RATIONAL_T>(id, MMAL_RATIONAL_T{num, den});
+        set_(&p.hdr);
+    }
+
+    void
+    set_string(uint32_t id, const std::string& value)
+    {
+        std::vector<uint8_t> bytes(sizeof(MMAL_PARAMETER_STRING_T) + value.size(), 0);
+        MMAL_PARAMETER_STRING_T* p = reinterpret_cast<MMAL_PARAMETER_STRING_T*>(bytes.data());
+        p->hdr.id = id;
+        p->hdr.size = uint32_t(bytes.size());
+        std::memcpy(p->str, value.c_str(), value.size() + 1);
+        set_(&p->hdr);
+    }
+
+    /**
+     * Get a parameter from the port. hdr must have the id and the size of the
+     * whole parameter structure, which is filled by VideoCore.
+     */
+    void
+    get_header(MMAL_PARAMETER_HEADER_T* hdr)
+    {
+        mmalpp_impl_::get_parameters_from_port_(port_, hdr);
+        remember_(hdr);
+    }
+
+    bool
+    get_boolean(uint32_t id)
+    {
+        MMAL_PARAMETER_BOOLEAN_T p = make_<MMAL_PARAMETER_BOOLEAN_T>(id);
+        p.enable = mmalpp_impl_::get_boolean_from_port_(port_, id);
+        remember_(&p.hdr);
+        return p.enable;
+    }
+
+    int64_t
+    get_int64(uint32_t id)
+    { return get_<MMAL_PARAMETER_INT64_T>(id, mmalpp_impl_::get_int64_from_port_(port_, id)); }
+
+    uint64_t
+    get_uint64(uint32_t id)
+    { return get_<MMAL_PARAMETER_UINT64_T>(id, mmalpp_impl_::get_uint64_from_port_(port_, id)); }
+
+    int32_t
+    get_int32(uint32_t id)
+    { return get_<MMAL_PARAMETER_INT32_T>(id, mmalpp_impl_::get_int32_from_port_(port_, id)); }
+
+    uint32_t
+    get_uint32(uint32_t id)
+    { return get_<MMAL_PARAMETER_UINT32_T>(id, mmalpp_impl_::get_uint32_from_port_(port_, id)); }
+
+    MMAL_RATIONAL_T
+    get_rational(uint32_t id)
+    { return get_<MMAL_PARAMETER_RATIONAL_T>(id, mmalpp_impl_::get_rational_from_port_(port_, id)); }
+
+    /**
+     * Begin a transaction: until the matching commit(), values are only
+     * staged. Transactions can be nested, the outermost commit() applies them.
+     */
+    void
+    begin()
+    {
+        if (!cache_)
+            throw std::logic_error("transactions need a port parameter cache");
+        std::lock_guard<std::mutex> lock(cache_->mutex_);
+        ++cache_->depth_;
+    }
+
+    /**
+     * Commit a transaction. The outermost commit applies every staged value
+     * (if cached, only the ones which differ from the last one applied), in the
+     * order they were first set.
+     * If VideoCore refuses one, the remaining ones are discarded and it throws.
+     */
+    void
+    commit()
+    {
+        if (!cache_)
+            throw std::logic_error("transactions need a port parameter cache");
+        std::lock_guard<std::mutex> lock(cache_->mutex_);
+        if (cache_->depth_ == 0)
+            throw std::logic_error("commit() without begin()");
+        if (--cache_->depth_ > 0)
+            return;
+
+        std::vector<std::vector<uint8_t>> staged;
+        staged.swap(cache_->staged_);
+        for (std::vector<uint8_t>& bytes : staged)
+            apply_(std::move(bytes));
+    }
+
+    /**
+     * Get how many calls to VideoCore have been skipped because the value was
+     * unchanged, or overwritten before commit().
+     */
+    uint64_t
+    saved_ipc() const
+    { return cache_ ? cache_->saved_.load(std::memory_order_relaxed) : 0; }
+
+    /**
+     * Forget the cached values, so that the next set of every parameter is applied.
+     */
+    void
+    invalidate()
+    {
+        if (cache_) {
+            std::lock_guard<std::mutex> lock(cache_->mutex_);
+            cache_->applied_.clear();
+        }
+    }
+
+private:
+    MMAL_PORT_T* port_;
+    mmalpp_impl_::Parameter_cache_* cache_;
+    bool cached_;
+
+    /// Parameters which act when they are set, rather than hold a state.
+    static bool
+    is_trigger_(uint32_t id)
+    {
+        switch (id) {
+        case MMAL_PARAMETER_CAPTURE:
+        case MMAL_PARAMETER_VIDEO_REQUEST_I_FRAME:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    /// Build a zeroed parameter structure (padding included, so that it can be
+    /// compared bytewise) with the given id.
+    template <typename P_>
+    static P_
+    make_(uint32_t id)
+    {
+        P_ p;
+        std::memset(&p, 0, sizeof(p));
+        p.hdr.id = id;
+        p.hdr.size = sizeof(P_);
+        return p;
+    }
+
+    template <typename P_, typename V_>
+    static P_
+    make_(uint32_t id, V_ value)
+    {
+        P_ p = make_<P_>(id);
+        p.value = value;
+        return p;
+    }
+
+    template <typename P_, typename V_>
+    V_
+    get_(uint32_t id, V_ value)
+    {
+        P_ p = make_<P_>(id, value);
+        remember_(&p.hdr);
+        return value;
+    }
+
+    static bool
+    same_(const std::vector<uint8_t>& bytes, const MMAL_PARAMETER_HEADER_T* hdr)
+    { return bytes.size() == hdr->size && std::memcmp(bytes.data(), hdr, hdr->size) == 0; }
+
+    static std::vector<uint8_t>
+    bytes_(const MMAL_PARAMETER_HEADER_T* hdr)
+    {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(hdr);
+        return std::vector<uint8_t>(p, p + hdr->size);
+    }
+
+    /// Set a parameter, skipping or staging it when possible.
+    void
+    set_(MMAL_PARAMETER_HEADER_T* hdr)
+    {
+        if (!cache_) {
+            mmalpp_impl_::set_parameters_to_port_(port_, hdr);
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(cache_->mutex_);
+        const auto applied = cache_->applied_.find(hdr->id);
+        const bool unchanged = (cached_ && !is_trigger_(hdr->id) &&
+                                applied != cache_->applied_.end() && same_(applied->second, hdr));
+
+        if (cache_->depth_ == 0) {
+            if (unchanged)
+                cache_->saved_.fetch_add(1, std::memory_order_relaxed);
+            else
+                apply_(bytes_(hdr));
+            return;
+        }
+
+        auto staged = std::find_if(cache_->staged_.begin(), cache_->staged_.end(),
+                                   [hdr] (const std::vector<uint8_t>& bytes) {
+            return reinterpret_cast<const MMAL_PARAMETER_HEADER_T*>(bytes.data())->id == hdr->id;
+        });
+        if (staged != cache_->staged_.end()) {
+            /// The staged value will never be sent.
+            cache_->saved_.fetch_add(1, std::memory_order_relaxed);
+            if (unchanged)
+                cache_->staged_.erase(staged);
+            else
+                *staged = bytes_(hdr);
+        } else if (unchanged)
+            cache_->saved_.fetch_add(1, std::memory_order_relaxed);
+        else
+            cache_->staged_.push_back(bytes_(hdr));
+    }
+
+    /// Send a parameter to VideoCore and cache it. The cache mutex must be held.
+    void
+    apply_(std::vector<uint8_t>&& bytes)
+    {
+        MMAL_PARAMETER_HEADER_T* hdr = reinterpret_cast<MMAL_PARAMETER_HEADER_T*>(bytes.data());
+        mmalpp_impl_::set_parameters_to_port_(port_, hdr);
+        const uint32_t id = hdr->id;
+        cache_->applied_[id] = std::move(bytes);
+    }
+
+    /// Cache a value read from VideoCore.
+    void
+    remember_(const MMAL_PARAMETER_HEADER_T* hdr)
+    {
+        if (cache_) {
+            std::lock_guard<std::mutex> lock(cache_->mutex_);
+            cache_->applied_[hdr->id] = bytes_(hdr);
+        }
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_PARAMETER_H
@@ -0,0 +1,478 @@
+#ifndef MMALPP_PIPELINE_H
+#define MMALPP_PIPELINE_H
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <interface/mmal/util/mmal_connection.h>
+
+#include "mmalpp_component.h"
+#include "mmalpp_connection.h"
+#include "mmalpp_format.h"
+#include "mmalpp_port.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// A timed step of Pipeline::start() or Pipeline::stop().
+struct Pipeline_step {
+
+    /// What has been done, e.g. "connect camera.output(2) -> encoder.input(0)".
+    std::string name;
+
+    /// Stage of the step. Steps of the same stage run in parallel.
+    std::size_t stage = 0;
+
+    /// Start time (since the beginning of start() or stop()) and duration, in ms.
+    double start_ms = 0;
+    double ms = 0;
+
+};
+
+/// Timing report of Pipeline::start() or Pipeline::stop().
+struct Pipeline_report {
+
+    /// Steps in the order they ended.
+    std::vector<Pipeline_step> steps;
+
+    /// Wall time of the whole start() or stop(), in ms.
+    double total_ms = 0;
+
+};
+
+/**
+ * Print a report, one step per line.
+ */
+inline std::ostream&
+operator<<(std::ostream& os, const Pipeline_report& report)
+{
+    for (const Pipeline_step& step : report.steps)
+        os << "stage " << step.stage << std::fixed << std::setprecision(3)
+           << "  at " << std::setw(9) << step.start_ms << " ms  took "
+           << std::setw(9) << step.ms << " ms  " << step.name << '\n';
+    return os << "total " << std::fixed << std::setprecision(3) << report.total_ms << " ms\n";
+}
+
+/// Declarative graph of Components. Declare the components, the formats of their
+/// output ports, the links between them and the output ports read by the host,
+/// then start() brings the graph up in the right order and stop() tears it down.
+///
+/// start() creates every component at once, then brings the components up by
+/// levels: a component comes after every component linked to its inputs, and
+/// the components of a level (e.g. a preview null_sink and an encoder fed by the
+/// same camera) are brought up in parallel. For each component it runs its setup
+/// callback, creates and enables the links to its inputs, sets and commits the
+/// formats of its outputs, enables its sink ports and the component itself, then
+/// sends the Pool of every sink port. stop() disables and releases the links and
+/// closes the components, in the reverse order.
+/// Every step is timed (see Pipeline_report), e.g. to cut the cold start time of
+/// an on-demand capture.
+class Pipeline {
+
+public:
+
+    using setup_type = std::function<void(Component&)>;
+    using format_type = std::function<void(Generic_port&)>;
+
+    /// Default link flags: tunnelled, buffers allocated by the input port.
+    static constexpr uint32_t default_link_flags = MMAL_CONNECTION_FLAG_TUNNELLING
+                                                 | MMAL_CONNECTION_FLAG_ALLOCATION_ON_INPUT;
+
+    /// ctor.
+    Pipeline() = default;
+
+    Pipeline(const Pipeline&) = delete;
+    Pipeline& operator=(const Pipeline&) = delete;
+
+    /// dtor. It tears the graph down if it is still up.
+    ~Pipeline()
+    {
+        try {
+            stop();
+        } catch (...) {}
+    }
+
+    /**
+     * Declare a component, e.g. add("camera", "vc.ril.camera"). setup is called
+     * on it before anything else (parameters, control port callback...).
+     */
+    Pipeline&
+    add(const std::string& name, const std::string& component, setup_type setup = nullptr)
+    {
+        if (find_(name) != npos_)
+            throw std::invalid_argument("component already in the pipeline: " + name);
+        Node_ node;
+        node.name = name;
+        node.component = component;
+        node.setup = std::move(setup);
+        nodes_.push_back(std::move(node));
+        return *this;
+    }
+
+    /**
+     * Declare the format of an output port: f writes it (e.g. copy_from() an
+     * input, set_format(), set_default_buffer()) once the links to the inputs of
+     * the component are up, then the format is committed.
+     */
+    Pipeline&
+    format(const std::string& name, uint16_t output, format_type f)
+    {
+        node_(name).formats.emplace_back(output, std::move(f));
+        return *this;
+    }
+
+    /**
+     * Declare the format of an output port as a Video_format.
+     */
+    Pipeline&
+    format(const std::string& name, uint16_t output, const Video_format& video_format)
+    {
+        return format(name, output, [video_format] (Generic_port& port) {
+            port.set_format(video_format);
+        });
+    }
+
+    /**
+     * Declare a link from an output port to an input port.
+     */
+    Pipeline&
+    link(const std::string& source, uint16_t output,
+         const std::string& target, uint16_t input,
+         uint32_t flags = default_link_flags)
+    {
+        Link_ l;
+        l.source = index_(source);
+        l.target = index_(target);
+        l.output = output;
+        l.input = input;
+        l.flags = flags;
+        links_.push_back(l);
+        return *this;
+    }
+
+    /**
+     * Declare an output port read by the host: it gets a Pool (of headers
+     * Buffers of size bytes, the recommended values if 0) and is enabled with
+     * callback (as in Generic_port::enable()), which must be copyable.
+     * A format change on the port (e.g. a new resolution in a decoded stream) is
+     * applied in place (see Generic_port::set_auto_reconfigure()), so the graph
+     * goes on without being rebuilt.
+     */
+    template <typename F_>
+    Pipeline&
+    sink(const std::string& name, uint16_t output, F_&& callback,
+         std::size_t headers = 0, uint32_t size = 0)
+    {
+        Sink_ s;
+        s.output = output;
+        s.headers = headers;
+        s.size = size;
+        s.enable = [callback = std::forward<F_>(callback)] (Generic_port& port) {
+            port.set_auto_reconfigure();
+            port.enable(callback);
+        };
+        node_(name).sinks.push_back(std::move(s));
+        return *this;
+    }
+
+    /**
+     * Bring the graph up and return the timing of every step. If a step throws,
+     * the components of its level are finished first, then the exception is
+     * rethrown: stop() tears down what is up.
+     */
+    Pipeline_report
+    start()
+    {
+        if (started_)
+            throw std::logic_error("the pipeline is already started");
+        const std::vector<std::vector<std::size_t>> levels = levels_();
+        Run_ run;
+        started_ = true;
+
+        std::vector<std::size_t> all(nodes_.size());
+        for (std::size_t i = 0; i < all.size(); ++i)
+            all[i] = i;
+        run_parallel_(all, [&] (std::size_t i) {
+            Node_& node = nodes_[i];
+            step_(run, 0, "create " + node.name + " (" + node.component + ")", [&] {
+                node.instance = std::make_unique<Component>(node.component);
+            });
+        });
+
+        for (std::size_t level = 0; level < levels.size(); ++level)
+            run_parallel_(levels[level], [&] (std::size_t i) { bring_up_(run, level + 1, i); });
+
+        return run.finish();
+    }
+
+    /**
+     * Tear the graph down and return the timing of every step. It does nothing
+     * if the graph is not up.
+     */
+    Pipeline_report
+    stop()
+    {
+        Run_ run;
+        if (!started_)
+            return run.finish();
+        const std::vector<std::vector<std::size_t>> levels = levels_();
+        for (std::size_t k = levels.size(); k-- > 0;)
+            run_parallel_(levels[k], [&] (std::size_t i) { tear_down_(run, levels.size() - k, i); });
+        started_ = false;
+        return run.finish();
+    }
+
+    /**
+     * Check if the graph is up.
+     */
+    bool
+    is_started() const
+    { return started_; }
+
+    /**
+     * Get a component of the graph. It exists while the graph is up (from the
+     * setup callbacks on).
+     */
+    Component&
+    component(const std::string& name)
+    {
+        Node_& node = node_(name);
+        if (!node.instance)
+            throw std::logic_error("the pipeline is not started: " + name);
+        return *node.instance;
+    }
+
+private:
+    struct Sink_ {
+        uint16_t output = 0;
+        std::size_t headers = 0;
+        uint32_t size = 0;
+        std::function<void(Generic_port&)> enable;
+    };
+
+    struct Node_ {
+        std::string name;
+        std::string component;
+        setup_type setup;
+        std::vector<std::pair<uint16_t, format_type>> formats;
+        std::vector<Sink_> sinks;
+        std::unique_ptr<Component> instance;
+    };
+
+    struct Link_ {
+        std::size_t source = 0;
+        std::size_t target = 0;
+        uint16_t output = 0;
+        uint16_t input = 0;
+        uint32_t flags = 0;
+        bool connected = false;
+    };
+
+    /// Clock and steps of a start() or stop().
+    struct Run_ {
+        using clock_ = std::chrono::steady_clock;
+
+        clock_::time_point begin = clock_::now();
+        std::mutex mutex;
+        Pipeline_report report;
+
+        double
+        since_begin(clock_::time_point t) const
+        { return std::chrono::duration<double, std::milli>(t - begin).count(); }
+
+        Pipeline_report
+        finish()
+        {
+            report.total_ms = since_begin(clock_::now());
+            return std::move(report);
+        }
+    };
+
+    static constexpr std::size_t npos_ = std::size_t(-1);
+
+    std::vector<Node_> nodes_;
+    std::vector<Link_> links_;
+    bool started_ = false;
+
+    std::size_t
+    find_(const std::string& name) const
+    {
+        for (std::size_t i = 0; i < nodes_.size(); ++i)
+            if (nodes_[i].name == name)
+                return i;
+        return npos_;
+    }
+
+    std::size_t
+    index_(const std::string& name) const
+    {
+        const std::size_t i = find_(name);
+        if (i == npos_)
+            throw std::invalid_argument("component not in the pipeline: " + name);
+        return i;
+    }
+
+    Node_&
+    node_(const std::string& name)
+    { return nodes_[index_(name)]; }
+
+    /// Group the components by level (Kahn's algorithm). Throws on cycles.
+    std::vector<std::vector<std::size_t>>
+    levels_() const
+    {
+        std::vector<std::size_t> pending(nodes_.size(), 0);
+        for (const Link_& l : links_)
+            ++pending[l.target];
+        std::vector<std::vector<std::size_t>> levels;
+        std::vector<std::size_t> current;
+        for (std::size_t i = 0; i < nodes_.size(); ++i)
+            if (!pending[i])
+                current.push_back(i);
+        std::size_t placed = 0;
+        while (!current.empty()) {
+            placed += current.size();
+            std::vector<std::size_t> next;
+            for (std::size_t i : current)
+                for (const Link_& l : links_)
+                    if (l.source == i && --pending[l.target] == 0)
+                        next.push_back(l.target);
+            levels.push_back(std::move(current));
+            current = std::move(next);
+        }
+        if (placed != nodes_.size())
+            throw std::logic_error("the pipeline links form a cycle");
+        return levels;
+    }
+
+    /// Run f on every index in parallel, then rethrow the first exception.
+    template <typename F_>
+    static void
+    run_parallel_(const std::vector<std::size_t>& indexes, F_&& f)
+    {
+        if (indexes.size() == 1) {
+            f(indexes.front());
+            return;
+        }
+        std::vector<std::future<void>> tasks;
+        tasks.reserve(indexes.size());
+        for (std::size_t i : indexes)
+            tasks.push_back(std::async(std::launch::async, [&f, i] { f(i); }));
+        std::exception_ptr error;
+        for (std::future<void>& task : tasks)
+            try {
+                task.get();
+            } catch (...) {
+                if (!error)
+                    error = std::current_exception();
+            }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+    /// Run a step and record its timing.
+    template <typename F_>
+    static void
+    step_(Run_& run, std::size_t stage, std::string name, F_&& f)
+    {
+        const Run_::clock_::time_point begin = Run_::clock_::now();
+        f();
+        const Run_::clock_::time_point end = Run_::clock_::now();
+        Pipeline_step step;
+        step.name = std::move(name);
+        step.stage = stage;
+        step.start_ms = run.since_begin(begin);
+        step.ms = std::chrono::duration<double, std::milli>(end - begin).count();
+        std::lock_guard<std::mutex> lock(run.mutex);
+        run.report.steps.push_back(std::move(step));
+    }
+
+    static std::string
+    port_name_(const Node_& node, const char* kind, uint16_t index)
+    { return node.name + "." + kind + "(" + std::to_string(index) + ")"; }
+
+    void
+    bring_up_(Run_& run, std::size_t stage, std::size_t i)
+    {
+        Node_& node = nodes_[i];
+        Component& c = *node.instance;
+        if (node.setup)
+            step_(run, stage, "setup " + node.name, [&] { node.setup(c); });
+
+        for (Link_& l : links_) {
+            if (l.target != i)
+                continue;
+            Node_& source = nodes_[l.source];
+            step_(run, stage, "connect " + port_name_(source, "output", l.output)
+                  + " -> " + port_name_(node, "input", l.input), [&] {
+                Port<OUTPUT>& out = source.instance->output(l.output);
+                out.connect_to(c.input(l.input), l.flags);
+                l.connected = true;
+                out.connection().enable();
+            });
+        }
+
+        for (auto& f : node.formats)
+            step_(run, stage, "commit " + port_name_(node, "output", f.first), [&] {
+                Port<OUTPUT>& port = c.output(f.first);
+                f.second(port);
+                port.commit();
+            });
+
+        for (Sink_& s : node.sinks)
+            step_(run, stage, "enable " + port_name_(node, "output", s.output), [&] {
+                Port<OUTPUT>& port = c.output(s.output);
+                port.create_pool(s.headers ? s.headers : port.buffer_num_recommended(),
+                                 s.size ? s.size : port.buffer_size_recommended());
+                s.enable(port);
+            });
+
+        step_(run, stage, "enable " + node.name, [&] { c.enable(); });
+
+        for (Sink_& s : node.sinks)
+            step_(run, stage, "send buffers to " + port_name_(node, "output", s.output), [&] {
+                c.output(s.output).send_all_buffers();
+            });
+    }
+
+    void
+    tear_down_(Run_& run, std::size_t stage, std::size_t i)
+    {
+        Node_& node = nodes_[i];
+        if (!node.instance)
+            return;
+        for (Link_& l : links_) {
+            if (l.target != i || !l.connected)
+                continue;
+            Node_& source = nodes_[l.source];
+            step_(run, stage, "disconnect " + port_name_(source, "output", l.output)
+                  + " -> " + port_name_(node, "input", l.input), [&] {
+                Connection& connection = source.instance->output(l.output).connection();
+                l.connected = false;
+                if (connection.is_enabled())
+                    connection.disable();
+                connection.release();
+            });
+        }
+        step_(run, stage, "close " + node.name, [&] {
+            std::unique_ptr<Component> component = std::move(node.instance);
+            component->close();
+        });
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_PIPELINE_H
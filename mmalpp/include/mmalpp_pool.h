@@ -1,15 +1,189 @@
 #ifndef MMALPP_POOL_H
 #define MMALPP_POOL_H
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <type_traits>
+#include <unordered_map>
+
 #include <interface/mmal/mmal_types.h>
 #include <interface/mmal/mmal_pool.h>
 
+#include "mmalpp_arena.h"
 #include "mmalpp_queue.h"
+#include "mmalpp_result.h"
+#include "mmalpp_types.h"
+#include "utils/mmalpp_callback_utils.h"
 #include "utils/mmalpp_pool_utils.h"
 #include "../macros.h"
 
 MMALPP_BEGIN
 
+/// Counters of the Buffers released to a Pool with a release callback
+/// (see Pool::on_release).
+struct Release_metrics {
+
+    /// Buffers taken by the callback, which never went through the Pool queue.
+    uint64_t direct = 0;
+
+    /// Buffers put in the Pool queue.
+    uint64_t queued = 0;
+
+};
+
+namespace mmalpp_impl_ {
+
+/// State the library keeps for a MMAL_POOL_T, for as long as it exists.
+struct Pool_state_ {
+
+    /// Arena of the payloads, if the pool has been created on one.
+    std::unique_ptr<Arena> arena_;
+
+    /// Release callback and its counters.
+    Callback_storage_ on_release_;
+    RELEASE_MODE mode_ = RECYCLE_DIRECT;
+    std::atomic<uint64_t> direct_{0};
+    std::atomic<uint64_t> queued_{0};
+
+};
+
+/// Registry of the pool states.
+struct Pool_registry_ {
+
+    std::mutex mutex_;
+    std::unordered_map<MMAL_POOL_T*, std::unique_ptr<Pool_state_>> states_;
+
+    static Pool_registry_&
+    instance()
+    {
+        static Pool_registry_ registry;
+        return registry;
+    }
+
+};
+
+/**
+ * Get the state of a pool, creating it if needed.
+ */
+inline Pool_state_&
+pool_state_(MMAL_POOL_T* pool_)
+{
+    Pool_registry_& r = Pool_registry_::instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    std::unique_ptr<Pool_state_>& state = r.states_[pool_];
+    if (!state)
+        state = std::make_unique<Pool_state_>();
+    return *state;
+}
+
+/**
+ * Get the state of a pool, or nullptr if it has none.
+ */
+inline Pool_state_*
+find_pool_state_(MMAL_POOL_T* pool_)
+{
+    Pool_registry_& r = Pool_registry_::instance();
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    auto it = r.states_.find(pool_);
+    return it == r.states_.end() ? nullptr : it->second.get();
+}
+
+/**
+ * Drop the state of a destroyed pool.
+ */
+inline void
+erase_pool_state_(MMAL_POOL_T* pool_)
+{
+    Pool_registry_& r = Pool_registry_::instance();
+    std::unique_ptr<Pool_state_> state;
+    std::lock_guard<std::mutex> lock(r.mutex_);
+    auto it = r.states_.find(pool_);
+    if (it != r.states_.end()) {
+        state = std::move(it->second);
+        r.states_.erase(it);
+    }
+}
+
+/**
+ * Create a pool whose payloads are slots of a new Arena. The arena has room
+ * for max_headers payloads, so the pool can grow up to that without remapping.
+ */
+inline MMAL_POOL_T*
+create_arena_pool_(std::size_t headers_,
+                   uint32_t size_,
+                   const Arena_options& options_,
+                   std::size_t max_headers_)
+{
+    auto arena = std::make_unique<Arena>(size_, std::max(headers_, max_headers_), options_);
+    MMAL_POOL_T* pool = create_pool_with_allocator_(
+                headers_, size_, arena.get(),
+                [] (void* context, uint32_t size) { return static_cast<Arena*>(context)->allocate(size); },
+                [] (void* context, void* mem) { static_cast<Arena*>(context)->deallocate(mem); });
+    if (pool)
+        pool_state_(pool).arena_ = std::move(arena);
+    return pool;
+}
+
+/**
+ * Put a released buffer header in its pool queue and wake up whoever waits for it.
+ * The pool callbacks queue headers themselves, instead of letting MMAL do it
+ * when they return, so that waiters are woken up after the header is there.
+ */
+inline MMAL_BOOL_T
+queue_trampoline_(MMAL_POOL_T* pool_, MMAL_BUFFER_HEADER_T* buffer_, void*)
+{
+    put_in_queue_(pool_->queue, buffer_);
+    notify_queue_(pool_->queue);
+    return MMAL_FALSE;
+}
+
+/**
+ * MMAL release callback of a pool, instantiated for each callback type.
+ * In direct mode the callback gets the header first and the header goes to the
+ * pool queue only if it isn't taken; in queued mode the header is queued, then
+ * the callback is run to wake up whoever waits for it.
+ */
+template <typename F_>
+MMAL_BOOL_T
+release_trampoline_(MMAL_POOL_T* pool_, MMAL_BUFFER_HEADER_T* buffer_, void* userdata_)
+{
+    Pool_state_* state = static_cast<Pool_state_*>(userdata_);
+    F_& f = state->on_release_.template get<F_>();
+    if (state->mode_ == RECYCLE_QUEUED) {
+        queue_trampoline_(pool_, buffer_, nullptr);
+        state->queued_.fetch_add(1, std::memory_order_relaxed);
+        try { f(Buffer(buffer_)); } catch (...) {}
+        return MMAL_FALSE;
+    }
+
+    bool taken = false;
+    try {
+        if constexpr (std::is_void<std::invoke_result_t<F_&, Buffer>>::value)
+            f(Buffer(buffer_));
+        else
+            taken = bool(f(Buffer(buffer_)));
+    } catch (...) {}
+    if (taken)
+        state->direct_.fetch_add(1, std::memory_order_relaxed);
+    else {
+        queue_trampoline_(pool_, buffer_, nullptr);
+        state->queued_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return MMAL_FALSE;
+}
+
+inline void
+watch_pool_releases_(MMAL_POOL_T* pool_)
+{
+    Pool_state_* state = find_pool_state_(pool_);
+    if (!state || state->on_release_.empty())
+        pool_set_callback_(pool_, &queue_trampoline_, nullptr);
+}
+
+};
+
 class Pool {
 public:
 
@@ -22,12 +196,106 @@ public:
         : pool_(mmalpp_impl_::create_pool_(headers, size))
     {}
 
+    /// Create a Pool whose payloads are allocated from one contiguous Arena
+    /// (aligned, optionally on huge pages and locked in memory), with room for
+    /// max(headers, max_headers) payloads of size bytes. It can be resized within
+    /// that room.
+    Pool(std::size_t headers,
+         uint32_t size,
+         const Arena_options& options,
+         std::size_t max_headers = 0)
+        : pool_(mmalpp_impl_::create_arena_pool_(headers, size, options, max_headers))
+    {}
+
     /**
      * Release all Buffers in the Pool.
      */
     void
     release()
-    { mmalpp_impl_::pool_release_(pool_); pool_ = nullptr; }
+    {
+        mmalpp_impl_::pool_release_(pool_);
+        mmalpp_impl_::erase_pool_state_(pool_);
+        pool_ = nullptr;
+    }
+
+    /**
+     * Get the Arena of the payloads, or nullptr if the Pool hasn't been
+     * created on one.
+     */
+    const Arena*
+    arena() const
+    {
+        mmalpp_impl_::Pool_state_* state = mmalpp_impl_::find_pool_state_(pool_);
+        return state ? state->arena_.get() : nullptr;
+    }
+
+    /**
+     * Run callback every time a Buffer is released to the Pool (the last reference
+     * to it is dropped), on the releasing thread, instead of only putting it back
+     * in the Pool queue. The callback gets the Buffer, already reset.
+     * With RECYCLE_DIRECT it can take the Buffer, e.g. send it straight back to a
+     * port or hand it to a waiting consumer, and return true; if it returns false
+     * (or nothing, or throws) the Buffer goes to the Pool queue as usual.
+     * With RECYCLE_QUEUED the Buffer is put in the Pool queue first and the callback
+     * is only a notification: the Buffer may already have been taken from the
+     * queue, so the callback must not use it.
+     * The callback replaces any other release callback of the Pool (MMAL has one
+     * slot, which is used by Connections for their own Pools), and must be set
+     * while no Buffer of the Pool is being released.
+     */
+    template <typename F_>
+    void
+    on_release(F_&& callback, RELEASE_MODE mode = RECYCLE_DIRECT)
+    {
+        mmalpp_impl_::Pool_state_& state = mmalpp_impl_::pool_state_(pool_);
+        mmalpp_impl_::pool_set_callback_(pool_, nullptr, nullptr);
+        state.on_release_.emplace(std::forward<F_>(callback));
+        state.mode_ = mode;
+        state.direct_ = 0;
+        state.queued_ = 0;
+        mmalpp_impl_::pool_set_callback_(pool_, &mmalpp_impl_::release_trampoline_<std::decay_t<F_>>, &state);
+    }
+
+    /**
+     * Send every released Buffer straight back to port while it is enabled,
+     * without a round trip through the Pool queue. Buffers which can't be sent
+     * are queued.
+     */
+    void
+    recycle_to(MMAL_PORT_T* port)
+    {
+        on_release([port] (const Buffer& buffer) {
+            return port->is_enabled && mmal_port_send_buffer(port, buffer.get()) == MMAL_SUCCESS;
+        });
+    }
+
+    /**
+     * Remove the release callback: Buffers only go back to the Pool queue
+     * (and wake up the Queue_sets waiting for it).
+     */
+    void
+    remove_on_release()
+    {
+        const bool watched = mmalpp_impl_::is_watched_queue_(pool_->queue);
+        mmalpp_impl_::pool_set_callback_(pool_, watched ? &mmalpp_impl_::queue_trampoline_ : nullptr, nullptr);
+        if (mmalpp_impl_::Pool_state_* state = mmalpp_impl_::find_pool_state_(pool_))
+            state->on_release_.reset();
+    }
+
+    /**
+     * Get how many released Buffers took each path since the release callback
+     * has been set.
+     */
+    Release_metrics
+    release_metrics() const
+    {
+        Release_metrics m;
+        if (mmalpp_impl_::Pool_state_* state = mmalpp_impl_::find_pool_state_(pool_)) {
+            m.direct = state->direct_.load(std::memory_order_relaxed);
+            m.queued = state->queued_.load(std::memory_order_relaxed);
+        }
+        return m;
+    }
 
     /**
      * Check if Pool exists.
@@ -46,12 +314,24 @@ public:
     get_buffer(int timeout_ms = 0)
     { return mmalpp_impl_::get_buffer_from_queue_(pool_->queue, timeout_ms); }
 
+    /**
+     * Same as get_buffer(), but it returns MMAL_EAGAIN instead of a null
+     * Buffer when none is available in time.
+     */
+    Result<Buffer>
+    try_get_buffer(int timeout_ms = 0) noexcept
+    {
+        if (MMAL_BUFFER_HEADER_T* buffer = mmalpp_impl_::get_buffer_from_queue_(pool_->queue, timeout_ms))
+            return Buffer(buffer);
+        return Result<Buffer>(MMAL_EAGAIN);
+    }
+
     /**
      * Get the Queue associated with the Pool.
      */
     Queue
     queue() const
-    { return {pool_->queue}; }
+    { return {pool_->queue, pool_}; }
 
     /**
      * Get the number of Buffers in the Pool.
@@ -83,6 +363,14 @@ public:
     resize(std::size_t headers, uint32_t size)
     { mmalpp_impl_::pool_resize_(pool_, headers, size); }
 
+    /**
+     * Set a pre-release callback on every Buffer of the Pool (see Buffer::set_pre_release).
+     * Pass nullptr to remove it.
+     */
+    void
+    set_pre_release(MMAL_BH_PRE_RELEASE_CB_T cb, void* userdata = nullptr)
+    { mmalpp_impl_::pool_set_pre_release_callback_(pool_, cb, userdata); }
+
     /**
      * Get the MMAL_POOL_T pointer.
      */
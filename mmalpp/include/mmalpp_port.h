@@ -1,8 +1,18 @@
 #ifndef MMALPP_PORT_H
 #define MMALPP_PORT_H
 
-#include <functional>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <future>
 #include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <interface/mmal/mmal_types.h>
 #include <interface/mmal/mmal_port.h>
@@ -11,57 +21,34 @@
 #include <interface/mmal/util/mmal_connection.h>
 
 #include "utils/mmalpp_port_utils.h"
+#include "utils/mmalpp_callback_utils.h"
+#include "utils/mmalpp_format_utils.h"
 #include "mmalpp_buffer.h"
+#include "mmalpp_coroutine.h"
+#include "mmalpp_event.h"
 #include "mmalpp_pool.h"
+#include "mmalpp_offload.h"
+#include "mmalpp_parameter.h"
+#include "mmalpp_result.h"
+#include "mmalpp_format.h"
+#include "mmalpp_stats.h"
 #include "mmalpp_types.h"
 #include "mmalpp_fwd_decl.h"
 #include "../macros.h"
 
 MMALPP_BEGIN
 
-/// This class is used to set parameter of ports.
-class Parameter {
-public:
+/// Counters of the buffer recycling done by the library on an output port.
+struct Recycle_metrics {
 
-    /// ctor.
-    Parameter(MMAL_PORT_T* port)
-        : port_(port)
-    {}
+    /// Buffers sent back to the port.
+    uint64_t resent = 0;
 
-    void
-    set_header(MMAL_PARAMETER_HEADER_T* hdr)
-    { mmalpp_impl_::set_parameters_to_port_(port_, hdr); }
+    /// Times the pool queue was empty when a resend was due.
+    uint64_t starved = 0;
 
-    void
-    set_boolean(uint32_t id, bool value)
-    { mmalpp_impl_::set_boolean_to_port_(port_, id, value); }
-
-    void
-    set_int64(uint32_t id, int64_t value)
-    { mmalpp_impl_::set_int64_to_port_(port_, id, value); }
-
-    void
-    set_uint64(uint32_t id, uint64_t value)
-    { mmalpp_impl_::set_uint64_to_port_(port_, id, value); }
-
-    void
-    set_int32(uint32_t id, int32_t value)
-    { mmalpp_impl_::set_int32_to_port_(port_, id, value); }
-
-    void
-    set_uint32(uint32_t id, uint32_t value)
-    { mmalpp_impl_::set_uint32_to_port_(port_, id, value); }
-
-    void
-    set_rational(uint32_t id, int32_t num, int32_t den)
-    { mmalpp_impl_::set_rational_to_port_(port_, id, num, den); }
-
-    void
-    set_string(uint32_t id, const std::string& value)
-    { mmalpp_impl_::set_string_to_port_(port_, id, value); }
-
-private:
-    MMAL_PORT_T* port_;
+    /// Buffers the port refused.
+    uint64_t send_errors = 0;
 
 };
 
@@ -70,13 +57,50 @@ class Generic_port {
 
 public:
 
+    /// Handler of exceptions thrown by port callbacks.
+    using error_handler_type = void (*)(Generic_port&, std::exception_ptr);
+
     // ctor.
     Generic_port (MMAL_PORT_T* port = nullptr,
                   MMAL_POOL_T* pool = nullptr)
         : port_(port),
-          pool_(pool)
+          pool_(pool),
+          p_data_ptr__(std::make_unique<P_data_ptr_>())
     {}
 
+    /// Move ctor. The private data follows the port, and the callbacks are
+    /// given the new Generic_port.
+    Generic_port(Generic_port&& other) noexcept
+        : port_(other.port_),
+          pool_(other.pool_),
+          p_data_ptr__(std::move(other.p_data_ptr__))
+    {
+        if (p_data_ptr__)
+            p_data_ptr__->instance__ = this;
+    }
+
+    Generic_port&
+    operator=(Generic_port&& other) noexcept
+    {
+        if (this != &other) {
+            if (p_data_ptr__)
+                wait_reconfigure();
+            port_ = other.port_;
+            pool_ = other.pool_;
+            p_data_ptr__ = std::move(other.p_data_ptr__);
+            if (p_data_ptr__)
+                p_data_ptr__->instance__ = this;
+        }
+        return *this;
+    }
+
+    /// dtor. It waits for the format changes being applied (see set_auto_reconfigure()).
+    ~Generic_port()
+    {
+        if (p_data_ptr__)
+            wait_reconfigure();
+    }
+
     /**
      * Check is this Port exists.
      */
@@ -85,11 +109,71 @@ public:
     { return port_ == nullptr; }
 
     /**
-     * Commit changes to the port's format.
+     * Commit changes to the port's format. The commit is skipped when the format
+     * is the same as the last one committed through this port, unless force is true.
+     * It returns true if the format has been committed.
+     * The last committed format only knows the commits made through this object:
+     * call invalidate_committed() if the format may have been committed elsewhere
+     * (e.g. by the commit of another port of the component). connect_to() does it
+     * for the target port, whose format MMAL commits.
+     */
+    bool
+    commit(bool force = false)
+    {
+        const Result<bool> committed = try_commit(force);
+        if (!committed)
+            mmalpp_impl_::e_check__(committed.status(), "cannot commit format on port "
+                                    + std::string(port_->name));
+        return *committed;
+    }
+
+    /**
+     * Same as commit(), but it returns the MMAL status instead of throwing.
+     */
+    Result<bool>
+    try_commit(bool force = false) noexcept
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        if (!force && data_.committed__
+                && mmalpp_impl_::compare_format_(data_.committed__.get(), format()) == 0) {
+            data_.skipped_commits__++;
+            return false;
+        }
+
+        if (MMAL_STATUS_T status = mmalpp_impl_::try_commit_format_(port_); status)
+            return Result<bool>(status);
+        if (!data_.committed__)
+            data_.committed__.reset(mmalpp_impl_::alloc_format_());
+        if (!data_.committed__)
+            return Result<bool>(MMAL_ENOMEM);
+        if (MMAL_STATUS_T status = mmalpp_impl_::try_full_copy_format_(format(), data_.committed__.get()); status) {
+            /// The format is committed anyway: just don't skip the next commit.
+            data_.committed__.reset();
+            return Result<bool>(status);
+        }
+        return true;
+    }
+
+    /**
+     * Forget the last committed format, so that the next commit() is applied.
      */
     void
-    commit()
-    { mmalpp_impl_::commit_format_(port_); }
+    invalidate_committed()
+    { p_data_ptr__->committed__.reset(); }
+
+    /**
+     * Write a Video_format into the port's format. It doesn't commit it.
+     */
+    void
+    set_format(const Video_format& video_format)
+    { video_format.apply_to(format()); }
+
+    /**
+     * Get how many commits have been skipped because the format was unchanged.
+     */
+    uint64_t
+    skipped_commits() const
+    { return p_data_ptr__->skipped_commits__; }
 
     /**
      * Copy format from another port.
@@ -205,11 +289,52 @@ public:
     { mmalpp_impl_::port_send_buffer(get(), buffer.get()); }
 
     /**
-     * Get Parameter instance to set port's parameter.
+     * Send a Unique_buffer to this port. Its reference is handed over to the port
+     * only if sending succeeds, otherwise the handle still owns it.
+     */
+    void
+    send_buffer(Unique_buffer&& buffer) const
+    {
+        mmalpp_impl_::port_send_buffer(get(), buffer.get());
+        buffer.detach();
+    }
+
+    /**
+     * Same as send_buffer(), but it returns the MMAL status instead of throwing,
+     * e.g. for the per-frame path of a callback.
+     */
+    Result<void>
+    try_send_buffer(const Buffer& buffer) const noexcept
+    { return Result<void>(mmalpp_impl_::try_port_send_buffer_(port_, buffer.get())); }
+
+    /**
+     * Same as send_buffer(Unique_buffer&&), but it returns the MMAL status
+     * instead of throwing. The handle still owns the Buffer if sending fails.
+     */
+    Result<void>
+    try_send_buffer(Unique_buffer&& buffer) const noexcept
+    {
+        const Result<void> sent(mmalpp_impl_::try_port_send_buffer_(port_, buffer.get()));
+        if (sent)
+            buffer.detach();
+        return sent;
+    }
+
+    /**
+     * Get Parameter instance to set port's parameter. Every value set is sent
+     * to VideoCore.
      */
     Parameter
     parameter() const
-    { return port_; }
+    { return {port_, &p_data_ptr__->parameters__}; }
+
+    /**
+     * Get Parameter instance to set port's parameter, which skips the values
+     * identical to the last ones applied to this port (see Parameter).
+     */
+    Parameter
+    cached_parameter() const
+    { return {port_, &p_data_ptr__->parameters__, true}; }
 
     /**
      * Get a MMAL_PORT_T* pointer.
@@ -231,7 +356,7 @@ public:
     template<typename U>
     void
     set_userdata(U& u)
-    { p_data_ptr__.userdata__ = reinterpret_cast<MMAL_PORT_USERDATA_T*>(&u); }
+    { p_data_ptr__->userdata__ = reinterpret_cast<MMAL_PORT_USERDATA_T*>(&u); }
 
     /**
      * Get userdata from the port already casted to U type.
@@ -239,44 +364,384 @@ public:
     template<typename U>
     U&
     get_userdata_as()
-    { return *reinterpret_cast<U*>(p_data_ptr__.userdata__); }
+    { return *reinterpret_cast<U*>(p_data_ptr__->userdata__); }
 
     /**
-     * Disable this port.
+     * Disable this port. In offload mode, it also waits for the workers to
+     * run the callback on the buffers still queued, then stops them.
      */
     void
     disable() const
-    { mmalpp_impl_::disable_port_(port_); }
+    {
+        wait_reconfigure();
+        stop_();
+    }
 
     /**
-     * Enable this port and set a callback.
+     * Enable this port and set a callback. The callback can take either a Buffer,
+     * which must be released by hand, or a Unique_buffer, which releases it
+     * automatically when it goes out of scope.
+     * The callback is stored inline (up to 64 bytes, bigger ones are allocated
+     * once here) and called without type erasure. If it throws, the exception goes
+     * to the error handler (see set_error_handler), the Buffer is released if the
+     * callback didn't own it, and an output port gets a new Buffer from its Pool.
+     * So a callback taking a Buffer must not throw after releasing it.
      */
     template<typename F_>
     void
     enable(F_&& f)
     {
-        p_data_ptr__.instance__ = this;
-        p_data_ptr__.callback__ = f;
-        port_->userdata = reinterpret_cast<MMAL_PORT_USERDATA_T*>(&p_data_ptr__);
+        p_data_ptr__->offload__.reset();
+        p_data_ptr__->instance__ = this;
+        p_data_ptr__->callback__.emplace(std::forward<F_>(f));
+        port_->userdata = reinterpret_cast<MMAL_PORT_USERDATA_T*>(p_data_ptr__.get());
 
-        mmalpp_impl_::enable_port_(port_,
-                                   [] (MMAL_PORT_T* port__, MMAL_BUFFER_HEADER_T* buffer__) {
-            try {
+        p_data_ptr__->trampoline__ = &Generic_port::callback_trampoline_<std::decay_t<F_>>;
+        mmalpp_impl_::enable_port_(port_, p_data_ptr__->trampoline__);
+    }
 
-                P_data_ptr_* ptr_ = reinterpret_cast<P_data_ptr_*>(port__->userdata);
-                ptr_->callback__(*ptr_->instance__, buffer__);
+    /**
+     * Enable this port in offload mode. The MMAL callback thread only pushes every
+     * Buffer into a bounded lock-free ring and returns, while a pool of worker
+     * threads runs the callback, so heavy work doesn't stall VideoCore.
+     * The callback has the same form as in enable(), but it can run concurrently
+     * on several workers. When the ring is full, options.overflow tells whether to
+     * drop the oldest or the newest Buffer (it is released and an output port gets
+     * a new one from its Pool) or to block the MMAL callback thread.
+     */
+    template<typename F_>
+    void
+    enable_offload(F_&& f, const Offload_options& options = {})
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        data_.offload__.reset();
+        data_.instance__ = this;
+        data_.callback__.emplace(std::forward<F_>(f));
+        data_.offload__ = std::make_unique<mmalpp_impl_::Offload_>(
+                    options, &Generic_port::dispatch_<std::decay_t<F_>>,
+                    &Generic_port::drop_, &data_);
+        port_->userdata = reinterpret_cast<MMAL_PORT_USERDATA_T*>(&data_);
+
+        try {
+            data_.trampoline__ = &Generic_port::offload_trampoline_;
+            mmalpp_impl_::enable_port_(port_, data_.trampoline__);
+        } catch (...) {
+            data_.offload__.reset();
+            throw;
+        }
+    }
+
+    /**
+     * Enable this output port in auto recycle mode. The callback gets a const
+     * Buffer& which is valid until it returns: then the library releases it and
+     * sends back to the port every Buffer available in the Pool queue, so the
+     * callback doesn't have to. To keep the data longer, copy the Buffer and
+     * acquire() it (or use a Deferred_release). Exceptions are handled as in enable().
+     */
+    template<typename F_>
+    void
+    enable_auto_recycle(F_&& f)
+    {
+        p_data_ptr__->offload__.reset();
+        p_data_ptr__->instance__ = this;
+        p_data_ptr__->callback__.emplace(std::forward<F_>(f));
+        port_->userdata = reinterpret_cast<MMAL_PORT_USERDATA_T*>(p_data_ptr__.get());
 
-            } catch (std::exception&)
-            {}
+        p_data_ptr__->trampoline__ = &Generic_port::recycle_trampoline_<std::decay_t<F_>>;
+        mmalpp_impl_::enable_port_(port_, p_data_ptr__->trampoline__);
+    }
+
+    /**
+     * Enable this port for coroutines: the Buffers it returns are kept for
+     * next_buffer() and capture_done() (C++20). Buffers consumed by coroutines
+     * go back to the Pool when released; to send them straight back to an output
+     * port, use pool().recycle_to(get()).
+     * Disabling the port releases the kept Buffers and resumes the waiting
+     * coroutine with a null Buffer.
+     */
+    void
+    enable_awaitable()
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        if (!data_.channel__)
+            data_.channel__ = std::make_unique<mmalpp_impl_::Buffer_channel_>();
+        data_.channel__->open();
+        enable([channel = data_.channel__.get()] (Generic_port&, Unique_buffer buffer) {
+            channel->push(buffer.detach().get());
         });
     }
 
+#ifdef MMALPP_HAS_COROUTINES
+    /**
+     * co_await port.next_buffer() suspends the coroutine until the port returns
+     * a Buffer, then resumes it on executor with the Buffer (null if the port has
+     * been disabled). The port must have been enabled with enable_awaitable(),
+     * and only one coroutine at a time can wait on it.
+     */
+    mmalpp_impl_::Buffer_awaiter_
+    next_buffer(Executor& executor = Inline_executor::instance())
+    { return {channel_(), executor}; }
+
+    /**
+     * co_await port.capture_done() suspends the coroutine until the port returns
+     * the end of a frame (or of the stream), then resumes it on executor with
+     * all the Buffers of the frame, e.g. the pieces of a JPEG. The port must have
+     * been enabled with enable_awaitable().
+     */
+    mmalpp_impl_::Capture_awaiter_
+    capture_done(Executor& executor = Inline_executor::instance())
+    { return {channel_(), executor}; }
+
     /**
-     * Create a Pool and associate it with this port.
+     * co_await port.flush_complete() flushes the port and suspends the coroutine
+     * until every Buffer of its Pool is back in the Pool queue, then resumes it
+     * on executor. The port callback must not send Buffers back to the port
+     * meanwhile (no auto recycle, no recycle_to()).
+     */
+    mmalpp_impl_::Flush_awaiter_
+    flush_complete(Executor& executor = Inline_executor::instance())
+    {
+        if (!pool_)
+            throw std::logic_error("flush_complete() needs the Pool of the port");
+        return {port_, pool_, executor};
+    }
+#endif
+
+    /**
+     * Get the counters of the buffers sent back to the port by the library
+     * (auto recycle mode, dropped buffers and failing callbacks).
+     */
+    Recycle_metrics
+    recycle_metrics() const
+    {
+        const P_data_ptr_& data_ = *p_data_ptr__;
+        Recycle_metrics m;
+        m.resent = data_.resent__.load(std::memory_order_relaxed);
+        m.starved = data_.starved__.load(std::memory_order_relaxed);
+        m.send_errors = data_.send_errors__.load(std::memory_order_relaxed);
+        return m;
+    }
+
+    /**
+     * Get a snapshot of the statistics of this port: host side counters recorded
+     * by the callback trampoline (rates, callback duration histogram, jitter),
+     * the occupancy of the Pool and the VideoCore counters of
+     * MMAL_PARAMETER_STATISTICS, if the port reports them.
+     */
+    Port_stats
+    stats() const
+    {
+        Port_stats stats;
+        p_data_ptr__->counters__.snapshot(stats);
+        if (pool_) {
+            stats.pool_size = pool_->headers_num;
+            stats.pool_available = mmalpp_impl_::get_queue_lenght_(pool_->queue);
+        }
+
+        MMAL_PARAMETER_STATISTICS_T vc = {};
+        vc.hdr.id = MMAL_PARAMETER_STATISTICS;
+        vc.hdr.size = sizeof(vc);
+        if (mmalpp_impl_::query_parameters_from_port_(port_, &vc.hdr) == MMAL_SUCCESS) {
+            stats.videocore = true;
+            stats.buffer_count = vc.buffer_count;
+            stats.frame_count = vc.frame_count;
+            stats.frames_skipped = vc.frames_skipped;
+            stats.frames_discarded = vc.frames_discarded;
+            stats.eos_seen = vc.eos_seen;
+            stats.maximum_frame_bytes = vc.maximum_frame_bytes;
+            stats.total_bytes = vc.total_bytes;
+            stats.corrupt_macroblocks = vc.corrupt_macroblocks;
+        }
+        return stats;
+    }
+
+    /**
+     * Reset the host side statistics. Call it while the port is disabled.
+     */
+    void
+    reset_stats()
+    { p_data_ptr__->counters__.reset(); }
+
+    /**
+     * Check if the port callback runs in offload mode.
+     */
+    bool
+    is_offloaded() const
+    { return p_data_ptr__->offload__ != nullptr; }
+
+    /**
+     * Get the queue metrics of the offload mode. They are all zero if the port
+     * has never been enabled in offload mode.
+     */
+    Offload_metrics
+    offload_metrics() const
+    { return p_data_ptr__->offload__ ? p_data_ptr__->offload__->metrics() : Offload_metrics{}; }
+
+    /**
+     * Set a handler of the events sent to this port (buffers whose command is
+     * not 0), called on the callback thread with (Generic_port&, const Event&)
+     * before the event Buffer is released. The port callback then only gets data
+     * Buffers. Exceptions go to the error handler. It must be set before the
+     * port is enabled.
+     */
+    template <typename F_>
+    void
+    on_event(F_&& handler)
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        data_.event_handler__.emplace(std::forward<F_>(handler));
+        data_.on_event__ = &Generic_port::event_trampoline_<std::decay_t<F_>>;
+    }
+
+    /**
+     * Reconfigure this output port in place whenever it gets a format change
+     * (see apply_format_change()), on a thread of its own, instead of leaving it
+     * stalled until the pipeline is rebuilt. The event handler, if any, is called
+     * first. It must be set before the port is enabled.
      */
     void
-    create_pool(std::size_t headers = 0, uint32_t size = 0)
-    { pool_ = mmalpp_impl_::port_pool_create_(port_, headers, size); }
+    set_auto_reconfigure(bool enable = true)
+    { p_data_ptr__->auto_reconfigure__ = enable; }
+
+    /**
+     * Apply a format change to this output port: the port is disabled, its
+     * format is replaced and committed, its Buffer number and size (and its Pool)
+     * are set to the recommended values of the new format (the minimum ones if
+     * larger), then it is enabled again with the same callback and gets all the
+     * Buffers of its Pool. MMAL can only resize a Pool when all its Buffers are
+     * back, so it waits up to timeout_ms for the ones held by the callback to be
+     * released; if they aren't, or the resize fails, the port is enabled again
+     * as it was and it throws. It must not be called from the port callback.
+     */
+    void
+    apply_format_change(const Format_changed_event& event,
+                        int timeout_ms = 1000)
+    {
+        if (!event.format)
+            throw std::invalid_argument("the format change has no format");
+        const bool enabled = is_enabled();
+        if (enabled)
+            stop_();
+
+        const uint32_t num = std::max(event.buffer_num_recommended, event.buffer_num_min);
+        const uint32_t size = std::max(event.buffer_size_recommended, event.buffer_size_min);
+        try {
+            if (pool_) {
+                if (!wait_pool_full_(timeout_ms))
+                    throw std::runtime_error("the Buffers of the Pool are not back, "
+                                             "it can't be resized");
+                mmalpp_impl_::pool_resize_(pool_, num, size);
+            }
+            mmalpp_impl_::full_copy_format_(event.format.get(), format());
+            commit(true);
+            port_->buffer_num = num;
+            port_->buffer_size = size;
+        } catch (...) {
+            /// Don't leave the port stalled: a new format change may still come.
+            if (enabled)
+                try { restart_(); } catch (...) {}
+            throw;
+        }
+
+        if (enabled)
+            restart_();
+    }
+
+    /**
+     * Wait until the auto reconfiguration has applied every format change
+     * received so far. disable() calls it.
+     */
+    void
+    wait_reconfigure() const
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        std::future<void> running;
+        {
+            std::lock_guard<std::mutex> lock(data_.reconfigure_mutex__);
+            running = std::move(data_.reconfigure__);
+        }
+        if (running.valid())
+            running.wait();
+    }
+
+    /**
+     * Set the handler of exceptions thrown by the port callback. It is called on
+     * the callback thread. Pass nullptr to only count them.
+     */
+    void
+    set_error_handler(error_handler_type handler)
+    { p_data_ptr__->error_handler__ = handler; }
+
+    /**
+     * Forget what has been set for a session: the callback (and its offload
+     * queue), the event handler, the auto reconfiguration, the error handler,
+     * the parameter cache and the last committed format. The host side counters
+     * (stats(), recycle_metrics(), callback_errors(), skipped_commits()) start from
+     * zero again, as on a new port.
+     * The port must be disabled.
+     */
+    void
+    clear_handlers()
+    {
+        wait_reconfigure();
+        P_data_ptr_& data_ = *p_data_ptr__;
+        data_.offload__.reset();
+        data_.callback__.reset();
+        data_.trampoline__ = nullptr;
+        data_.event_handler__.reset();
+        data_.on_event__ = nullptr;
+        data_.auto_reconfigure__ = false;
+        data_.error_handler__ = nullptr;
+        parameter().invalidate();
+        invalidate_committed();
+
+        data_.counters__.reset();
+        data_.errors__ = 0;
+        data_.resent__ = 0;
+        data_.starved__ = 0;
+        data_.send_errors__ = 0;
+        data_.skipped_commits__ = 0;
+    }
+
+    /**
+     * Get the number of exceptions thrown by the port callback.
+     */
+    uint64_t
+    callback_errors() const
+    { return p_data_ptr__->errors__.load(std::memory_order_relaxed); }
+
+    /**
+     * Create a Pool and associate it with this port. If zero_copy is true, the port
+     * is first asked to use zero-copy buffers (see enable_zero_copy()).
+     * It returns true if the Pool is zero-copy.
+     */
+    bool
+    create_pool(std::size_t headers = 0, uint32_t size = 0, bool zero_copy = false)
+    {
+        const bool accepted = zero_copy && enable_zero_copy();
+        pool_ = mmalpp_impl_::port_pool_create_(port_, headers, size);
+        return accepted;
+    }
+
+    /**
+     * Ask this port to use zero-copy buffers: their payload is allocated in memory
+     * shared with VideoCore, so raw frames don't go through the VCHIQ transport.
+     * It must be called before the port is enabled and its Pool created.
+     * It returns true if the port accepted it.
+     */
+    bool
+    enable_zero_copy()
+    {
+        p_data_ptr__->zero_copy__ = (mmalpp_impl_::enable_zero_copy_(port_) == MMAL_SUCCESS);
+        return p_data_ptr__->zero_copy__;
+    }
+
+    /**
+     * Check if this port accepted zero-copy buffers.
+     */
+    bool
+    is_zero_copy() const
+    { return p_data_ptr__->zero_copy__; }
 
     /**
      * Get the Pool associated with this port.
@@ -286,13 +751,59 @@ public:
     { return pool_; }
 
     /**
-     * Send all Buffer on the associated Pool to this port.
+     * Change the number of Buffers (and their size, if not 0) of the associated Pool.
+     * MMAL can only resize a Pool when all its Buffers are back, so an enabled
+     * port is disabled, it waits up to timeout_ms for the Buffers held by the
+     * callback to be released, then the Pool is resized and the port enabled
+     * again with the same callback, and an output port gets all the Buffers back
+     * (see send_all_buffers()). If the Buffers aren't back, or the resize fails,
+     * the port is enabled again as it was and it throws.
+     * It must not be called from the port callback.
+     */
+    void
+    resize_pool(std::size_t headers, uint32_t size = 0, int timeout_ms = 1000)
+    {
+        if (!pool_)
+            throw std::logic_error("resize_pool() needs the Pool of the port");
+        wait_reconfigure();
+        const bool enabled = is_enabled();
+        if (enabled)
+            stop_();
+
+        try {
+            if (!wait_pool_full_(timeout_ms))
+                throw std::runtime_error("the Buffers of the Pool are not back, "
+                                         "it can't be resized");
+            if (size == 0 && pool_->headers_num)
+                size = pool_->header[0]->alloc_size;
+            mmalpp_impl_::pool_resize_(pool_, headers, size);
+            port_->buffer_num = uint32_t(headers);
+            if (size)
+                port_->buffer_size = size;
+        } catch (...) {
+            /// Don't leave the port stalled.
+            if (enabled)
+                try { restart_(); } catch (...) {}
+            throw;
+        }
+
+        if (enabled)
+            restart_();
+    }
+
+    /**
+     * Send all Buffer on the associated Pool to this port. It stops when the
+     * Pool queue is empty.
      */
     void
     send_all_buffers()
     {
-        for(std::size_t i = 0; i < pool_->headers_num; ++i)
-            send_buffer(mmalpp_impl_::get_buffer_from_queue_(pool_->queue));
+        for(std::size_t i = 0; i < pool_->headers_num; ++i) {
+            MMAL_BUFFER_HEADER_T* buffer = mmalpp_impl_::get_buffer_from_queue_no_time_(pool_->queue);
+            if (!buffer)
+                break;
+            send_buffer(Buffer(buffer));
+        }
     }
 
     /**
@@ -300,22 +811,320 @@ public:
      */
     void
     release_pool()
-    { mmalpp_impl_::port_pool_release_(port_, pool_); }
+    {
+        mmalpp_impl_::port_pool_release_(port_, pool_);
+        mmalpp_impl_::erase_pool_state_(pool_);
+        pool_ = nullptr;
+    }
 
 protected:
     MMAL_PORT_T* port_;
     MMAL_POOL_T* pool_;
 
-    /// Private data
+    /// Private data. It is allocated once, so its address (stored in the
+    /// MMAL port userdata) doesn't change if the Generic_port is moved; the move
+    /// operations point instance__ to the new Generic_port.
     struct P_data_ptr_
     {
-        using cb_type_ = std::function<void(Generic_port&, Buffer)>;
+        Generic_port* instance__ = nullptr;
+        mmalpp_impl_::Callback_storage_ callback__;
+        MMAL_PORT_USERDATA_T* userdata__ = nullptr;
+        error_handler_type error_handler__ = nullptr;
+        std::atomic<uint64_t> errors__{0};
+        std::atomic<uint64_t> resent__{0};
+        std::atomic<uint64_t> starved__{0};
+        std::atomic<uint64_t> send_errors__{0};
+        std::unique_ptr<mmalpp_impl_::Offload_> offload__;
+        mmalpp_impl_::Parameter_cache_ parameters__;
+        std::unique_ptr<MMAL_ES_FORMAT_T, void (*)(MMAL_ES_FORMAT_T*)> committed__{
+            nullptr, &mmalpp_impl_::free_format_};
+        uint64_t skipped_commits__ = 0;
+        mmalpp_impl_::Port_counters_ counters__;
+        bool zero_copy__ = false;
+        MMAL_PORT_BH_CB_T trampoline__ = nullptr;
+        std::unique_ptr<mmalpp_impl_::Buffer_channel_> channel__;
+        mmalpp_impl_::Callback_storage_ event_handler__;
+        void (*on_event__)(P_data_ptr_&, const Event&) = nullptr;
+        bool auto_reconfigure__ = false;
+        std::mutex reconfigure_mutex__;
+        std::optional<Format_changed_event> pending_format__;
+        bool reconfiguring__ = false;
+        std::future<void> reconfigure__;
+    };
+
+    std::unique_ptr<P_data_ptr_> p_data_ptr__;
+
+    /// Get the channel of a port enabled with enable_awaitable().
+    mmalpp_impl_::Buffer_channel_&
+    channel_() const
+    {
+        if (!p_data_ptr__->channel__)
+            throw std::logic_error("the port has not been enabled with enable_awaitable()");
+        return *p_data_ptr__->channel__;
+    }
+
+    /// Wait up to timeout_ms for every Buffer of the Pool to be back in its
+    /// queue. It returns false if some are still out.
+    bool
+    wait_pool_full_(int timeout_ms)
+    {
+        using clock_ = std::chrono::steady_clock;
+        const clock_::time_point deadline = clock_::now() + std::chrono::milliseconds(timeout_ms);
+        /// Take the Buffers as they come back, so that each wait is a blocking
+        /// get on the queue, then put them back in the same order.
+        std::vector<MMAL_BUFFER_HEADER_T*> back;
+        while (back.size() < pool_->headers_num) {
+            const auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_::now()).count();
+            MMAL_BUFFER_HEADER_T* buffer = mmalpp_impl_::get_buffer_from_queue_(pool_->queue, left > 0 ? int(left) : 0);
+            if (!buffer)
+                break;
+            back.push_back(buffer);
+        }
+        for (auto it = back.rbegin(); it != back.rend(); ++it)
+            mmalpp_impl_::put_back_in_queue_(pool_->queue, *it);
+        return back.size() == pool_->headers_num;
+    }
+
+    /// Records the duration of a callback when destroyed.
+    struct Duration_ {
+        mmalpp_impl_::Port_counters_& counters_;
+        const int64_t start_ = mmalpp_impl_::Port_counters_::now();
+
+        explicit Duration_(mmalpp_impl_::Port_counters_& counters)
+            : counters_(counters)
+        {}
+
+        ~Duration_()
+        { counters_.duration(mmalpp_impl_::Port_counters_::now() - start_); }
+    };
+
+    /// MMAL callback, instantiated for each callback type.
+    template <typename F_>
+    static void
+    callback_trampoline_(MMAL_PORT_T* port__, MMAL_BUFFER_HEADER_T* buffer__)
+    {
+        P_data_ptr_* ptr_ = reinterpret_cast<P_data_ptr_*>(port__->userdata);
+        if (buffer__->cmd && event_(ptr_, buffer__))
+            return;
+        ptr_->counters__.arrival(buffer__->length, mmalpp_impl_::Port_counters_::now());
+        dispatch_<F_>(ptr_, buffer__);
+    }
+
+    /// MMAL callback of the offload mode.
+    static void
+    offload_trampoline_(MMAL_PORT_T* port__, MMAL_BUFFER_HEADER_T* buffer__)
+    {
+        P_data_ptr_* ptr_ = reinterpret_cast<P_data_ptr_*>(port__->userdata);
+        if (buffer__->cmd && event_(ptr_, buffer__))
+            return;
+        ptr_->counters__.arrival(buffer__->length, mmalpp_impl_::Port_counters_::now());
+        ptr_->offload__->push(buffer__);
+    }
+
+    /// Run the callback on a buffer header.
+    template <typename F_>
+    static void
+    dispatch_(void* data__, MMAL_BUFFER_HEADER_T* buffer__)
+    {
+        P_data_ptr_* ptr_ = static_cast<P_data_ptr_*>(data__);
+        constexpr bool owns_ = std::is_invocable<F_&, Generic_port&, Unique_buffer>::value;
+        const Duration_ duration_(ptr_->counters__);
+        try {
+            F_& f_ = ptr_->callback__.template get<F_>();
+            if constexpr (owns_)
+                f_(*ptr_->instance__, Unique_buffer(buffer__));
+            else
+                f_(*ptr_->instance__, Buffer(buffer__));
+        } catch (...) {
+            ptr_->instance__->callback_error_(buffer__, !owns_, std::current_exception());
+        }
+    }
+
+    /// MMAL callback of the auto recycle mode.
+    template <typename F_>
+    static void
+    recycle_trampoline_(MMAL_PORT_T* port__, MMAL_BUFFER_HEADER_T* buffer__)
+    {
+        P_data_ptr_* ptr_ = reinterpret_cast<P_data_ptr_*>(port__->userdata);
+        if (buffer__->cmd && event_(ptr_, buffer__))
+            return;
+        const int64_t start_ = mmalpp_impl_::Port_counters_::now();
+        ptr_->counters__.arrival(buffer__->length, start_);
+        try {
+            const Buffer buffer_(buffer__);
+            ptr_->callback__.template get<F_>()(*ptr_->instance__, buffer_);
+        } catch (...) {
+            ptr_->instance__->report_error_(std::current_exception());
+        }
+        ptr_->counters__.duration(mmalpp_impl_::Port_counters_::now() - start_);
+        ptr_->instance__->recycle_(buffer__, true);
+    }
+
+    /// Decode an event buffer header, release it and hand the Event to the event
+    /// handler and to the auto reconfiguration. It returns false, leaving the
+    /// buffer header to the callback, if the port has neither.
+    static bool
+    event_(P_data_ptr_* ptr_, MMAL_BUFFER_HEADER_T* buffer__) noexcept
+    {
+        if (!ptr_->on_event__ && !ptr_->auto_reconfigure__)
+            return false;
+
+        Generic_port& port_ = *ptr_->instance__;
+        std::optional<Event> event_;
+        try {
+            event_ = parse_event(Buffer(buffer__));
+        } catch (...) {
+            port_.report_error_(std::current_exception());
+        }
+        mmalpp_impl_::release_buffer_header_(buffer__);
+        if (!event_)
+            return true;
+
+        if (ptr_->on_event__)
+            try {
+                ptr_->on_event__(*ptr_, *event_);
+            } catch (...) {
+                port_.report_error_(std::current_exception());
+            }
+        if (ptr_->auto_reconfigure__)
+            if (const Format_changed_event* f = std::get_if<Format_changed_event>(&*event_))
+                port_.schedule_reconfigure_(*f);
+        return true;
+    }
 
-        Generic_port* instance__;
-        cb_type_ callback__;
-        MMAL_PORT_USERDATA_T* userdata__;
+    /// Call the event handler, instantiated for each handler type.
+    template <typename F_>
+    static void
+    event_trampoline_(P_data_ptr_& data__, const Event& event__)
+    { data__.event_handler__.template get<F_>()(*data__.instance__, event__); }
+
+    /// Queue a format change for the reconfiguration thread, starting it if it
+    /// isn't running. Only the last pending format change is applied.
+    void
+    schedule_reconfigure_(const Format_changed_event& event) noexcept
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        std::future<void> finished;
+        try {
+            std::lock_guard<std::mutex> lock(data_.reconfigure_mutex__);
+            data_.pending_format__ = event;
+            if (data_.reconfiguring__)
+                return;
+            finished = std::move(data_.reconfigure__);
+            data_.reconfigure__ = std::async(std::launch::async, &Generic_port::reconfigure_, &data_);
+            data_.reconfiguring__ = true;
+        } catch (...) {
+            report_error_(std::current_exception());
+        }
+    }
+
+    /// Body of the reconfiguration thread: apply the pending format changes.
+    static void
+    reconfigure_(P_data_ptr_* ptr_) noexcept
+    {
+        for (;;) {
+            Format_changed_event event_;
+            {
+                std::lock_guard<std::mutex> lock(ptr_->reconfigure_mutex__);
+                if (!ptr_->pending_format__) {
+                    ptr_->reconfiguring__ = false;
+                    return;
+                }
+                event_ = std::move(*ptr_->pending_format__);
+                ptr_->pending_format__.reset();
+            }
+            try {
+                ptr_->instance__->apply_format_change(event_);
+            } catch (...) {
+                ptr_->instance__->report_error_(std::current_exception());
+            }
+        }
+    }
+
+    /// Disable the port, and stop its offload workers and its channel.
+    void
+    stop_() const
+    {
+        mmalpp_impl_::disable_port_(port_);
+        if (p_data_ptr__->offload__)
+            p_data_ptr__->offload__->stop();
+        if (p_data_ptr__->channel__)
+            p_data_ptr__->channel__->close();
+    }
 
-    } p_data_ptr__;
+    /// Enable the port again after stop_(), with the same callback, and send
+    /// the Buffers of its Pool to an output port.
+    void
+    restart_()
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        if (data_.channel__)
+            data_.channel__->open();
+        mmalpp_impl_::enable_port_(port_, data_.trampoline__);
+        if (data_.offload__)
+            data_.offload__->start();
+        if (port_->type == MMAL_PORT_TYPE_OUTPUT && pool_)
+            send_all_buffers();
+    }
+
+    /// Recycle a buffer header dropped by the offload queue.
+    static void
+    drop_(void* data__, MMAL_BUFFER_HEADER_T* buffer__)
+    { static_cast<P_data_ptr_*>(data__)->instance__->recycle_(buffer__, true); }
+
+    /// Handle an exception thrown by the callback: report it and recycle the
+    /// buffer header.
+    void
+    callback_error_(MMAL_BUFFER_HEADER_T* buffer, bool release, std::exception_ptr e) noexcept
+    {
+        report_error_(e);
+        recycle_(buffer, release);
+    }
+
+    /// Count an exception thrown by the callback and pass it to the error handler.
+    void
+    report_error_(std::exception_ptr e) noexcept
+    {
+        P_data_ptr_& data_ = *p_data_ptr__;
+        data_.errors__.fetch_add(1, std::memory_order_relaxed);
+        if (data_.error_handler__)
+            try { data_.error_handler__(*this, e); } catch (...) {}
+    }
+
+    /// Check if the pool hands released buffer headers to a callback before its
+    /// queue (see Pool::on_release): an empty queue is not starvation then.
+    bool
+    recycled_directly_() const noexcept
+    {
+        mmalpp_impl_::Pool_state_* state = mmalpp_impl_::find_pool_state_(pool_);
+        return state && !state->on_release_.empty() && state->mode_ == RECYCLE_DIRECT;
+    }
+
+    /// Release a buffer header the callback didn't consume, if nobody else did,
+    /// and send back to an enabled output port every header of its pool queue.
+    void
+    recycle_(MMAL_BUFFER_HEADER_T* buffer, bool release) noexcept
+    {
+        if (release)
+            mmalpp_impl_::release_buffer_header_(buffer);
+        if (port_->type != MMAL_PORT_TYPE_OUTPUT || !port_->is_enabled || !pool_)
+            return;
+
+        P_data_ptr_& data_ = *p_data_ptr__;
+        uint64_t sent = 0;
+        while (MMAL_BUFFER_HEADER_T* b = mmalpp_impl_::get_buffer_from_queue_no_time_(pool_->queue)) {
+            if (mmal_port_send_buffer(port_, b) != MMAL_SUCCESS) {
+                mmalpp_impl_::release_buffer_header_(b);
+                data_.send_errors__.fetch_add(1, std::memory_order_relaxed);
+                break;
+            }
+            ++sent;
+        }
+        if (sent)
+            data_.resent__.fetch_add(sent, std::memory_order_relaxed);
+        else if (!recycled_directly_())
+            data_.starved__.fetch_add(1, std::memory_order_relaxed);
+    }
 
 };
 
@@ -330,6 +1139,30 @@ public:
     {}
 };
 
+/// Specialization of Port<CONTROL>
+template <>
+class Port<CONTROL> : public Generic_port {
+public:
+
+    /// ctor.
+    Port(MMAL_PORT_T* port)
+        : Generic_port(port)
+    {}
+
+    /**
+     * Enable this port for the events of its component: handler is called with
+     * every decoded Event, as in on_event(), and any other Buffer is released.
+     */
+    template <typename F_>
+    void
+    enable_events(F_&& handler)
+    {
+        on_event(std::forward<F_>(handler));
+        enable([] (Generic_port&, Unique_buffer) {});
+    }
+
+};
+
 /// Specialization of Port<INPUT>
 template <>
 class Port<INPUT> : public Generic_port {
@@ -362,10 +1195,33 @@ public:
      * Connect this OUTPUT Port to an INPUT Port. When this connection has been created,
      * it will set a pointer to this connection in the INPUT Port class. When this connection
      * will be released that pointer will be set to nullptr.
+     * If zero_copy is true and the connection is not tunnelled, both ports are asked
+     * to use zero-copy buffers before the connection creates its Pool: it returns
+     * true if both accepted.
      */
-    void
-    connect_to(Port<INPUT>& target, uint32_t flags = 0)
-    { connection_ = std::make_unique<Connection>(this, &target, flags); }
+    bool
+    connect_to(Port<INPUT>& target, uint32_t flags = 0, bool zero_copy = false)
+    {
+        bool accepted = false;
+        if (zero_copy && !(flags & MMAL_CONNECTION_FLAG_TUNNELLING)) {
+            accepted = enable_zero_copy();
+            accepted = target.enable_zero_copy() && accepted;
+        }
+        connection_ = std::make_unique<Connection>(this, &target, flags);
+        /// MMAL committed the format of this port on target.
+        target.invalidate_committed();
+        return accepted;
+    }
+
+    /**
+     * Connect this OUTPUT Port to an INPUT Port through a tap (see Connection::tap()):
+     * every Buffer goes through callback on its way to target, without copies.
+     * The connection can't be tunnelled. zero_copy is the same as in connect_to().
+     * (Defined in mmalpp_connection.h.)
+     */
+    template <typename F_>
+    bool
+    tap_to(Port<INPUT>& target, F_&& callback, uint32_t flags = 0, bool zero_copy = false);
 
     /**
      * Get the Connection.
@@ -374,6 +1230,13 @@ public:
     connection()
     { return *connection_.get(); }
 
+    /**
+     * Check if this port has a Connection which has not been released.
+     * (Defined in mmalpp_connection.h.)
+     */
+    bool
+    is_connected() const;
+
 private:
     /// Connection pointer. This is the same Connection object of the INPUT Port
     /// which is connected to.
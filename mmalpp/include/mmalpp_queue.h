@@ -1,15 +1,212 @@
 #ifndef MMALPP_QUEUE_H
 #define MMALPP_QUEUE_H
 
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
 #include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_pool.h>
 #include <interface/mmal/mmal_queue.h>
 
 #include "mmalpp_buffer.h"
+#include "mmalpp_executor.h"
+#include "mmalpp_result.h"
 #include "utils/mmalpp_queue_utils.h"
 #include "../macros.h"
 
 MMALPP_BEGIN
 
+namespace mmalpp_impl_ {
+
+/// Something waiting for buffer headers put in a queue (see Queue_set).
+class Queue_watcher_ {
+
+public:
+
+    /**
+     * Called, with the watchers locked, after a buffer header has been put in
+     * queue. Return true to stop watching it and be fired.
+     */
+    virtual bool
+    ready(MMAL_QUEUE_T* queue) = 0;
+
+    /**
+     * Called once ready() returned true, after the watchers have been unlocked.
+     */
+    virtual void
+    fire()
+    {}
+
+protected:
+    ~Queue_watcher_() = default;
+
+};
+
+/// Watchers of the queues.
+struct Queue_watchers_ {
+
+    std::atomic<std::size_t> count_{0};
+    std::mutex mutex_;
+    std::unordered_multimap<MMAL_QUEUE_T*, Queue_watcher_*> watchers_;
+
+    static Queue_watchers_&
+    instance()
+    {
+        static Queue_watchers_ watchers;
+        return watchers;
+    }
+
+};
+
+/**
+ * Tell watcher whenever a buffer header is put in a queue by the library.
+ */
+inline void
+watch_queue_(MMAL_QUEUE_T* queue_, Queue_watcher_* watcher_)
+{
+    Queue_watchers_& w = Queue_watchers_::instance();
+    std::lock_guard<std::mutex> lock(w.mutex_);
+    w.watchers_.emplace(queue_, watcher_);
+    w.count_.fetch_add(1, std::memory_order_relaxed);
+}
+
+/**
+ * Stop telling watcher about a queue.
+ */
+inline void
+unwatch_queue_(MMAL_QUEUE_T* queue_, Queue_watcher_* watcher_)
+{
+    Queue_watchers_& w = Queue_watchers_::instance();
+    std::lock_guard<std::mutex> lock(w.mutex_);
+    auto range = w.watchers_.equal_range(queue_);
+    for (auto it = range.first; it != range.second; ++it)
+        if (it->second == watcher_) {
+            w.watchers_.erase(it);
+            w.count_.fetch_sub(1, std::memory_order_relaxed);
+            return;
+        }
+}
+
+/**
+ * Check if anybody watches a queue.
+ */
+inline bool
+is_watched_queue_(MMAL_QUEUE_T* queue_)
+{
+    Queue_watchers_& w = Queue_watchers_::instance();
+    if (!w.count_.load(std::memory_order_relaxed))
+        return false;
+    std::lock_guard<std::mutex> lock(w.mutex_);
+    return w.watchers_.count(queue_) != 0;
+}
+
+/**
+ * Tell the watchers of a queue that a buffer header has been put in it. Call it
+ * after the put. It costs an atomic load when nobody watches any queue: the put
+ * and the registration of a watcher are ordered by the lock of the MMAL queue.
+ */
+inline void
+notify_queue_(MMAL_QUEUE_T* queue_)
+{
+    Queue_watchers_& w = Queue_watchers_::instance();
+    if (!w.count_.load(std::memory_order_relaxed))
+        return;
+    std::vector<Queue_watcher_*> fired;
+    {
+        std::lock_guard<std::mutex> lock(w.mutex_);
+        auto range = w.watchers_.equal_range(queue_);
+        for (auto it = range.first; it != range.second;)
+            if (it->second->ready(queue_)) {
+                fired.push_back(it->second);
+                it = w.watchers_.erase(it);
+                w.count_.fetch_sub(1, std::memory_order_relaxed);
+            } else
+                ++it;
+    }
+    for (Queue_watcher_* watcher : fired)
+        watcher->fire();
+}
+
+/**
+ * Make the releases of pool tell the watchers of its queue, unless its release
+ * callback already does. Defined in mmalpp_pool.h.
+ */
+inline void
+watch_pool_releases_(MMAL_POOL_T* pool_);
+
+#ifdef MMALPP_HAS_COROUTINES
+
+/**
+ * Awaitable of Queue::next_buffer(). If the queue is empty the coroutine watches
+ * it, and is posted to the executor by whoever puts the next buffer header.
+ * If the queue is the one of a pool, the releases of the pool are watched too.
+ */
+class Queue_awaiter_ final : Queue_watcher_ {
+
+public:
+
+    Queue_awaiter_(MMAL_QUEUE_T* queue, MMAL_POOL_T* pool, Executor& executor)
+        : queue_(queue),
+          pool_(pool),
+          executor_(executor)
+    {}
+
+    /// dtor. A coroutine destroyed while suspended stops watching the queue.
+    ~Queue_awaiter_()
+    {
+        if (coroutine_)
+            unwatch_queue_(queue_, this);
+    }
+
+    bool
+    await_ready()
+    {
+        buffer_ = get_buffer_from_queue_no_time_(queue_);
+        return buffer_ != nullptr;
+    }
+
+    bool
+    await_suspend(std::coroutine_handle<> coroutine)
+    {
+        coroutine_ = coroutine;
+        if (pool_)
+            watch_pool_releases_(pool_);
+        watch_queue_(queue_, this);
+        /// A buffer header may have been put before the watch: look again.
+        notify_queue_(queue_);
+        return true;
+    }
+
+    Buffer
+    await_resume() const
+    { return buffer_; }
+
+private:
+    MMAL_QUEUE_T* queue_;
+    MMAL_POOL_T* pool_;
+    Executor& executor_;
+    std::coroutine_handle<> coroutine_;
+    MMAL_BUFFER_HEADER_T* buffer_ = nullptr;
+
+    bool
+    ready(MMAL_QUEUE_T* queue) override
+    {
+        buffer_ = get_buffer_from_queue_no_time_(queue);
+        return buffer_ != nullptr;
+    }
+
+    void
+    fire() override
+    { executor_.post(coroutine_); }
+
+};
+
+#endif
+
+};
+
 class Queue {
 public:
 
@@ -18,8 +215,11 @@ public:
         : queue_(mmalpp_impl_::create_queue_())
     {}
 
-    Queue(MMAL_QUEUE_T* queue)
-        : queue_(queue)
+    /// pool is the Pool owning queue, if any (see Pool::queue()).
+    Queue(MMAL_QUEUE_T* queue,
+          MMAL_POOL_T* pool = nullptr)
+        : queue_(queue),
+          pool_(pool)
     {}
 
     /**
@@ -48,14 +248,34 @@ public:
      */
     void
     put(const Buffer& buffer)
-    { mmalpp_impl_::put_in_queue_(queue_, buffer.get()); }
+    {
+        mmalpp_impl_::put_in_queue_(queue_, buffer.get());
+        mmalpp_impl_::notify_queue_(queue_);
+    }
+
+    /**
+     * Put a Unique_buffer into a queue. Its reference is handed over to the queue.
+     */
+    void
+    put(Unique_buffer&& buffer)
+    { put(buffer.detach()); }
 
     /**
      * Put back a Buffer into a queue.
      */
     void
     put_back(const Buffer& buffer)
-    { mmalpp_impl_::put_back_in_queue_(queue_, buffer.get()); }
+    {
+        mmalpp_impl_::put_back_in_queue_(queue_, buffer.get());
+        mmalpp_impl_::notify_queue_(queue_);
+    }
+
+    /**
+     * Put back a Unique_buffer into a queue. Its reference is handed over to the queue.
+     */
+    void
+    put_back(Unique_buffer&& buffer)
+    { put_back(buffer.detach()); }
 
     /**
      * Get a Buffer from the queue.
@@ -64,8 +284,42 @@ public:
     get_buffer(int timeout_ms = 0)
     { return mmalpp_impl_::get_buffer_from_queue_(queue_, timeout_ms); }
 
+    /**
+     * Same as get_buffer(), but it returns MMAL_EAGAIN instead of a null
+     * Buffer when none is available in time.
+     */
+    Result<Buffer>
+    try_get_buffer(int timeout_ms = 0) noexcept
+    {
+        if (MMAL_BUFFER_HEADER_T* buffer = mmalpp_impl_::get_buffer_from_queue_(queue_, timeout_ms))
+            return Buffer(buffer);
+        return Result<Buffer>(MMAL_EAGAIN);
+    }
+
+#ifdef MMALPP_HAS_COROUTINES
+    /**
+     * Wait for a Buffer without blocking a thread: co_await queue.next_buffer()
+     * suspends the coroutine until a Buffer is put in the queue by the library
+     * (put(), put_back() or a Pool release), then resumes it on executor.
+     * On the Queue of a Pool without a release callback (see Pool::on_release),
+     * one which wakes up the coroutine is set: it must not be a Pool created
+     * by a Connection, whose callback belongs to MMAL.
+     */
+    mmalpp_impl_::Queue_awaiter_
+    next_buffer(Executor& executor = Inline_executor::instance())
+    { return {queue_, pool_, executor}; }
+#endif
+
+    /**
+     * Get the MMAL_QUEUE_T pointer.
+     */
+    MMAL_QUEUE_T*
+    get() const
+    { return queue_; }
+
 private:
     MMAL_QUEUE_T* queue_;
+    MMAL_POOL_T* pool_ = nullptr;
 
 };
 
@@ -0,0 +1,203 @@
+#ifndef MMALPP_QUEUE_SET_H
+#define MMALPP_QUEUE_SET_H
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+#include "mmalpp_buffer.h"
+#include "mmalpp_pool.h"
+#include "mmalpp_queue.h"
+#include "utils/mmalpp_futex_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Buffer returned by Queue_set::wait(), with the index of the queue it comes from.
+struct Ready_buffer {
+
+    /// Index of the queue (as returned by Queue_set::add()), npos if buffer is null.
+    std::size_t index = npos;
+
+    /// The Buffer, null on timeout or cancellation.
+    Buffer buffer = nullptr;
+
+    static constexpr std::size_t npos = std::size_t(-1);
+
+    /**
+     * Check if a Buffer has been returned.
+     */
+    explicit operator bool() const
+    { return !buffer.is_null(); }
+
+};
+
+/// Set of Queues and Pools a single thread can wait on at once, e.g. to service
+/// every port of a component from one thread. The thread sleeps on a futex until
+/// a Buffer is put in one of them, the timeout expires or the set is cancelled.
+/// Queues are woken up by Queue::put()/put_back(), Pools whenever a Buffer is
+/// released to them. Buffers put in a queue with the MMAL C API don't wake the
+/// set up: call notify() after doing it.
+/// Queues and Pools must be removed from the set (or the set destroyed) before
+/// they are released.
+class Queue_set {
+
+public:
+
+    /// ctor.
+    Queue_set() = default;
+
+    Queue_set(const Queue_set&) = delete;
+    Queue_set& operator=(const Queue_set&) = delete;
+
+    /// dtor.
+    ~Queue_set()
+    {
+        for (MMAL_QUEUE_T* queue : queues_)
+            if (queue)
+                mmalpp_impl_::unwatch_queue_(queue, &watcher_);
+    }
+
+    /**
+     * Add a Queue to the set and return its index.
+     */
+    std::size_t
+    add(const Queue& queue)
+    { return add_(queue.get()); }
+
+    /**
+     * Add a Pool to the set and return its index. If the Pool has no release
+     * callback (see Pool::on_release), one which wakes up the set is set on it:
+     * it must not be a Pool created by a Connection, whose callback belongs to MMAL.
+     */
+    std::size_t
+    add(Pool& pool)
+    {
+        const std::size_t index = add_(pool.queue().get());
+        mmalpp_impl_::watch_pool_releases_(pool.get());
+        return index;
+    }
+
+    /**
+     * Remove the queue at index from the set. Indexes of the other ones don't change.
+     */
+    void
+    remove(std::size_t index)
+    {
+        if (index < queues_.size() && queues_[index]) {
+            mmalpp_impl_::unwatch_queue_(queues_[index], &watcher_);
+            queues_[index] = nullptr;
+        }
+    }
+
+    /**
+     * Wait for a Buffer in any queue of the set. If timeout_ms is greater than
+     * 0 it will wait up to timeout, if it is 0 it will only look at the queues,
+     * if it is less than 0 it will wait until a Buffer arrives or the set is cancelled.
+     * Queues are scanned round robin, so a busy one can't starve the others.
+     */
+    Ready_buffer
+    wait(int timeout_ms = -1)
+    {
+        Ready_buffer ready;
+        event_.wait(timeout_ms, [&] {
+            return cancelled_.load(std::memory_order_acquire) || try_get_(ready);
+        });
+        return ready;
+    }
+
+    /**
+     * Wake up the threads waiting on the set, after a Buffer has been put in
+     * one of its queues without the library.
+     */
+    void
+    notify()
+    { event_.notify(); }
+
+    /**
+     * Cancel the set: waiting threads return a null Buffer at once, and so do
+     * the following wait() calls until reset() is called.
+     */
+    void
+    cancel()
+    {
+        cancelled_.store(true, std::memory_order_release);
+        event_.notify();
+    }
+
+    /**
+     * Undo cancel().
+     */
+    void
+    reset()
+    { cancelled_.store(false, std::memory_order_release); }
+
+    /**
+     * Check if the set has been cancelled.
+     */
+    bool
+    is_cancelled() const
+    { return cancelled_.load(std::memory_order_acquire); }
+
+    /**
+     * Get the number of queue slots (removed ones included).
+     */
+    std::size_t
+    size() const
+    { return queues_.size(); }
+
+private:
+    /// Wakes up the set when a Buffer is put in one of its queues.
+    struct Watcher_ final : mmalpp_impl_::Queue_watcher_ {
+        mmalpp_impl_::Futex_event_& event_;
+
+        explicit Watcher_(mmalpp_impl_::Futex_event_& event)
+            : event_(event)
+        {}
+
+        bool
+        ready(MMAL_QUEUE_T*) override
+        {
+            event_.notify();
+            return false;
+        }
+    };
+
+    std::vector<MMAL_QUEUE_T*> queues_;
+    mmalpp_impl_::Futex_event_ event_;
+    Watcher_ watcher_{event_};
+    std::atomic<bool> cancelled_{false};
+    std::atomic<std::size_t> next_{0};
+
+    std::size_t
+    add_(MMAL_QUEUE_T* queue)
+    {
+        mmalpp_impl_::watch_queue_(queue, &watcher_);
+        queues_.push_back(queue);
+        return queues_.size() - 1;
+    }
+
+    bool
+    try_get_(Ready_buffer& ready)
+    {
+        const std::size_t n = queues_.size();
+        const std::size_t first = next_.load(std::memory_order_relaxed);
+        for (std::size_t k = 0; k < n; ++k) {
+            const std::size_t i = (first + k) % n;
+            if (!queues_[i])
+                continue;
+            if (MMAL_BUFFER_HEADER_T* buffer = mmalpp_impl_::get_buffer_from_queue_no_time_(queues_[i])) {
+                next_.store(i + 1, std::memory_order_relaxed);
+                ready.index = i;
+                ready.buffer = buffer;
+                return true;
+            }
+        }
+        return false;
+    }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_QUEUE_SET_H
@@ -0,0 +1,171 @@
+#ifndef MMALPP_RESULT_H
+#define MMALPP_RESULT_H
+
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+#include <interface/mmal/mmal_types.h>
+
+#include "utils/exceptions/mmalpp_exceptions.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Outcome of the noexcept (try_) counterparts of the throwing methods, meant
+/// for per-frame paths: either a value of type T, or the MMAL_STATUS_T of the
+/// failure as MMAL returned it. Nothing is thrown nor formatted on failure;
+/// value() throws as the throwing method would have, if it is ever needed.
+template <typename T>
+class Result {
+
+public:
+
+    using value_type = T;
+
+    /// ctors. A value is taken implicitly, but not an enum (unless it is T):
+    /// MMAL_STATUS_T converts to bool and to integers, so return MMAL_ENOMEM
+    /// would be a success. A failure is always built explicitly from its status.
+    template <typename U = T,
+              typename = std::enable_if_t<std::is_convertible<U&&, T>::value &&
+                                          (!std::is_enum<std::decay_t<U>>::value ||
+                                           std::is_same<std::decay_t<U>, T>::value)>>
+    Result(U&& value) noexcept(std::is_nothrow_constructible<T, U&&>::value)
+        : value_(std::forward<U>(value)),
+          status_(MMAL_SUCCESS)
+    {}
+
+    explicit Result(MMAL_STATUS_T status) noexcept
+        : value_(),
+          status_(status)
+    {}
+
+    /**
+     * Check if there is a value.
+     */
+    bool
+    has_value() const noexcept
+    { return status_ == MMAL_SUCCESS; }
+
+    explicit operator bool() const noexcept
+    { return has_value(); }
+
+    /**
+     * Get the status: MMAL_SUCCESS if there is a value.
+     */
+    MMAL_STATUS_T
+    status() const noexcept
+    { return status_; }
+
+    /**
+     * Get the value. It throws if there is none.
+     */
+    T&
+    value()
+    {
+        check_();
+        return value_;
+    }
+
+    const T&
+    value() const
+    {
+        check_();
+        return value_;
+    }
+
+    /**
+     * Get the value, or def if there is none.
+     */
+    T
+    value_or(T def) const
+    { return has_value() ? value_ : std::move(def); }
+
+    /**
+     * Access the value without checking it.
+     */
+    T&
+    operator*() noexcept
+    { return value_; }
+
+    const T&
+    operator*() const noexcept
+    { return value_; }
+
+    T*
+    operator->() noexcept
+    { return &value_; }
+
+    const T*
+    operator->() const noexcept
+    { return &value_; }
+
+private:
+    T value_;
+    MMAL_STATUS_T status_;
+
+    void
+    check_() const
+    {
+        if (status_ != MMAL_SUCCESS) {
+            mmalpp_impl_::e_check__(status_, "no value");
+            throw std::runtime_error("no value");
+        }
+    }
+
+};
+
+/// Outcome of a noexcept method without a value: just its MMAL_STATUS_T.
+template <>
+class Result<void> {
+
+public:
+
+    using value_type = void;
+
+    /// ctors.
+    Result() noexcept
+        : status_(MMAL_SUCCESS)
+    {}
+
+    explicit Result(MMAL_STATUS_T status) noexcept
+        : status_(status)
+    {}
+
+    /**
+     * Check if the operation succeeded.
+     */
+    bool
+    has_value() const noexcept
+    { return status_ == MMAL_SUCCESS; }
+
+    explicit operator bool() const noexcept
+    { return has_value(); }
+
+    /**
+     * Get the status.
+     */
+    MMAL_STATUS_T
+    status() const noexcept
+    { return status_; }
+
+    /**
+     * Throw if the operation failed.
+     */
+    void
+    value() const
+    {
+        if (status_ != MMAL_SUCCESS) {
+            mmalpp_impl_::e_check__(status_, "operation failed");
+            throw std::runtime_error("operation failed");
+        }
+    }
+
+private:
+    MMAL_STATUS_T status_;
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_RESULT_H
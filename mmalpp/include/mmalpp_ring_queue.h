@@ -0,0 +1,160 @@
+#ifndef MMALPP_RING_QUEUE_H
+#define MMALPP_RING_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include <interface/mmal/mmal_buffer.h>
+
+#include "mmalpp_buffer.h"
+#include "utils/mmalpp_futex_utils.h"
+#include "utils/mmalpp_ring_utils.h"
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/**
+ * Bounded queue of Buffer handles on a lock-free ring, with the same surface
+ * as Queue. Threads only sleep (on a futex) when the ring is empty (getters) or
+ * full (putters). Buffers put back go to a small side list which get_buffer()
+ * empties first; it takes a lock, but it is only looked at when it is not empty.
+ */
+template <typename Ring_>
+class Ring_queue_ {
+
+public:
+
+    /// ctor. The capacity is rounded up to a power of two.
+    explicit Ring_queue_(std::size_t capacity)
+        : ring_(capacity)
+    {}
+
+    Ring_queue_(const Ring_queue_&) = delete;
+    Ring_queue_& operator=(const Ring_queue_&) = delete;
+
+    /**
+     * Get the number of Buffers in the queue. It is exact only when no other
+     * thread is using the queue.
+     */
+    std::size_t
+    size() const
+    { return ring_.size() + back_size_.load(std::memory_order_acquire); }
+
+    /**
+     * Get the capacity of the queue.
+     */
+    std::size_t
+    capacity() const
+    { return ring_.capacity(); }
+
+    /**
+     * Put a Buffer into the queue. If the queue is full it waits up to timeout_ms
+     * for room (0 doesn't wait, less than 0 waits forever). It returns false if
+     * the Buffer has not been queued.
+     */
+    bool
+    put(const Buffer& buffer, int timeout_ms = -1)
+    {
+        MMAL_BUFFER_HEADER_T* header = buffer.get();
+        if (!room_.wait(timeout_ms, [&] { return ring_.try_push(header); }))
+            return false;
+        items_.notify();
+        return true;
+    }
+
+    /**
+     * Put a Unique_buffer into the queue. Its reference is handed over to the queue
+     * only if it has been queued.
+     */
+    bool
+    put(Unique_buffer&& buffer, int timeout_ms = -1)
+    {
+        if (!put(buffer.get(), timeout_ms))
+            return false;
+        buffer.detach();
+        return true;
+    }
+
+    /**
+     * Put back a Buffer into the queue: it is the next one get_buffer() returns.
+     * It never waits, since the Buffer was taken from the queue.
+     */
+    void
+    put_back(const Buffer& buffer)
+    {
+        {
+            std::lock_guard<std::mutex> lock(back_mutex_);
+            back_.push_back(buffer.get());
+            back_size_.fetch_add(1, std::memory_order_release);
+        }
+        items_.notify();
+    }
+
+    /**
+     * Put back a Unique_buffer into the queue. Its reference is handed over to the queue.
+     */
+    void
+    put_back(Unique_buffer&& buffer)
+    { put_back(buffer.detach()); }
+
+    /**
+     * Get a Buffer from the queue. If a timeout is greater than 0 it will wait
+     * up to timeout, then will abort if nothing is returned.
+     * If timeout is 0 it will get a Buffer without waiting. If timeout is less than 0
+     * the function will block until a Buffer will be available.
+     */
+    Buffer
+    get_buffer(int timeout_ms = 0)
+    {
+        MMAL_BUFFER_HEADER_T* header = nullptr;
+        if (!items_.wait(timeout_ms, [&] { return try_get_(header); }))
+            return nullptr;
+        room_.notify();
+        return header;
+    }
+
+private:
+    Ring_ ring_;
+    Futex_event_ items_;
+    Futex_event_ room_;
+
+    std::mutex back_mutex_;
+    std::vector<MMAL_BUFFER_HEADER_T*> back_;
+    std::atomic<std::size_t> back_size_{0};
+
+    bool
+    try_get_(MMAL_BUFFER_HEADER_T*& header)
+    {
+        if (back_size_.load(std::memory_order_acquire)) {
+            std::lock_guard<std::mutex> lock(back_mutex_);
+            if (!back_.empty()) {
+                header = back_.back();
+                back_.pop_back();
+                back_size_.fetch_sub(1, std::memory_order_release);
+                return true;
+            }
+        }
+        return ring_.try_pop(header);
+    }
+
+};
+
+};
+
+/// Lock-free queue of Buffers between one producer thread and one consumer
+/// thread (put_back() is called by the consumer). See Mpmc_queue.
+using Spsc_queue = mmalpp_impl_::Ring_queue_<mmalpp_impl_::Spsc_ring_<MMAL_BUFFER_HEADER_T*>>;
+
+/// Lock-free queue of Buffers between any number of threads. Unlike Queue
+/// (MMAL_QUEUE_T, which takes a mutex on every put and get) it is bounded: put()
+/// waits when it is full. Buffers are passed by handle, their references are
+/// not touched.
+using Mpmc_queue = mmalpp_impl_::Ring_queue_<mmalpp_impl_::Mpmc_ring_<MMAL_BUFFER_HEADER_T*>>;
+
+MMALPP_END
+
+#endif // MMALPP_RING_QUEUE_H
@@ -0,0 +1,109 @@
+#ifndef MMALPP_SPAN_H
+#define MMALPP_SPAN_H
+
+#include <cstddef>
+#include <type_traits>
+
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Non-owning view over a contiguous sequence of T (like std::span).
+/// Its iterators are plain pointers, so standard algorithms can use bulk copies.
+template <typename T>
+class Span {
+
+public:
+
+    using element_type = T;
+    using value_type = std::remove_cv_t<T>;
+    using size_type = std::size_t;
+    using pointer = T*;
+    using reference = T&;
+    using iterator = T*;
+
+    /// ctors.
+    constexpr Span() noexcept
+        : data_(nullptr),
+          size_(0)
+    {}
+
+    constexpr Span(T* data, std::size_t size) noexcept
+        : data_(data),
+          size_(size)
+    {}
+
+    /// Span<T> is convertible to Span<const T>.
+    template <typename U,
+              typename = std::enable_if_t<std::is_convertible<U(*)[], T(*)[]>::value>>
+    constexpr Span(const Span<U>& other) noexcept
+        : data_(other.data()),
+          size_(other.size())
+    {}
+
+    /**
+     * Get a pointer to the first element.
+     */
+    constexpr T*
+    data() const noexcept
+    { return data_; }
+
+    /**
+     * Get the number of elements.
+     */
+    constexpr std::size_t
+    size() const noexcept
+    { return size_; }
+
+    /**
+     * Get the size of the view in bytes.
+     */
+    constexpr std::size_t
+    size_bytes() const noexcept
+    { return size_ * sizeof(T); }
+
+    /**
+     * Check if the view is empty.
+     */
+    constexpr bool
+    empty() const noexcept
+    { return size_ == 0; }
+
+    /**
+     * Access the n-th element. This operator doesn't do bound check.
+     */
+    constexpr T&
+    operator[](std::size_t n) const noexcept
+    { return data_[n]; }
+
+    /**
+     * Get a view over count elements starting at offset.
+     * This function doesn't check bounds.
+     */
+    constexpr Span
+    subspan(std::size_t offset, std::size_t count) const noexcept
+    { return {data_ + offset, count}; }
+
+    /**
+     * Begin iterator.
+     */
+    constexpr iterator
+    begin() const noexcept
+    { return data_; }
+
+    /**
+     * End iterator. It points one past the last element.
+     */
+    constexpr iterator
+    end() const noexcept
+    { return data_ + size_; }
+
+private:
+    T* data_;
+    std::size_t size_;
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_SPAN_H
@@ -0,0 +1,168 @@
+#ifndef MMALPP_STATS_H
+#define MMALPP_STATS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+
+#include "../macros.h"
+
+MMALPP_BEGIN
+
+/// Snapshot of the statistics of a port (see Generic_port::stats()).
+struct Port_stats {
+
+    /// Number of buckets of the callback duration histogram. Bucket 0 counts
+    /// callbacks shorter than 1 us, bucket i those in [2^(i-1), 2^i) us, and the
+    /// last one everything longer.
+    static constexpr std::size_t histogram_buckets = 16;
+
+    /// Host side, recorded when MMAL returns a buffer to the port callback.
+    uint64_t buffers = 0;
+    uint64_t bytes = 0;
+    double buffers_per_second = 0;
+    double bytes_per_second = 0;
+    /// Smoothed variation of the interval between buffers (RFC 3550 style).
+    double jitter_us = 0;
+    uint64_t max_callback_us = 0;
+    std::array<uint64_t, histogram_buckets> callback_us_histogram = {};
+
+    /// Pool of the port.
+    std::size_t pool_size = 0;
+    std::size_t pool_available = 0;
+
+    /// VideoCore side, from MMAL_PARAMETER_STATISTICS. videocore is false if the
+    /// port doesn't report them.
+    bool videocore = false;
+    uint32_t buffer_count = 0;
+    uint32_t frame_count = 0;
+    uint32_t frames_skipped = 0;
+    uint32_t frames_discarded = 0;
+    uint32_t eos_seen = 0;
+    uint32_t maximum_frame_bytes = 0;
+    int64_t total_bytes = 0;
+    uint32_t corrupt_macroblocks = 0;
+
+};
+
+namespace mmalpp_impl_ {
+
+/**
+ * Host side counters of a port. Arrivals are recorded by the MMAL callback thread
+ * only, callback durations by any thread running the callback. Every counter is a
+ * relaxed atomic, so recording costs a clock read and a few uncontended stores.
+ */
+class Port_counters_ {
+
+public:
+
+    using clock_ = std::chrono::steady_clock;
+
+    /**
+     * Get the current time in nanoseconds.
+     */
+    static int64_t
+    now()
+    { return std::chrono::duration_cast<std::chrono::nanoseconds>(clock_::now().time_since_epoch()).count(); }
+
+    /**
+     * Record a buffer returned by MMAL. Called on the MMAL callback thread.
+     */
+    void
+    arrival(uint32_t bytes, int64_t now)
+    {
+        const int64_t last = last_ns_.load(std::memory_order_relaxed);
+        if (last) {
+            const int64_t interval = now - last;
+            const int64_t prev = interval_ns_.load(std::memory_order_relaxed);
+            if (prev) {
+                const int64_t d = interval > prev ? interval - prev : prev - interval;
+                const int64_t j = jitter_ns_.load(std::memory_order_relaxed);
+                jitter_ns_.store(j + (d - j) / 16, std::memory_order_relaxed);
+            }
+            interval_ns_.store(interval, std::memory_order_relaxed);
+        } else {
+            first_ns_.store(now, std::memory_order_relaxed);
+            first_bytes_.store(bytes, std::memory_order_relaxed);
+        }
+        last_ns_.store(now, std::memory_order_relaxed);
+        buffers_.store(buffers_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        bytes_.store(bytes_.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    }
+
+    /**
+     * Record how long a callback took.
+     */
+    void
+    duration(int64_t ns)
+    {
+        const uint64_t us = ns > 0 ? uint64_t(ns) / 1000 : 0;
+        std::size_t bucket = 0;
+        while (bucket < Port_stats::histogram_buckets - 1 && (us >> bucket))
+            ++bucket;
+        histogram_[bucket].fetch_add(1, std::memory_order_relaxed);
+        uint64_t max = max_us_.load(std::memory_order_relaxed);
+        while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed))
+        {}
+    }
+
+    /**
+     * Fill the host side of a snapshot.
+     */
+    void
+    snapshot(Port_stats& stats) const
+    {
+        stats.buffers = buffers_.load(std::memory_order_relaxed);
+        stats.bytes = bytes_.load(std::memory_order_relaxed);
+        const int64_t first = first_ns_.load(std::memory_order_relaxed);
+        const int64_t last = last_ns_.load(std::memory_order_relaxed);
+        if (stats.buffers > 1 && last > first) {
+            const double seconds = double(last - first) / 1e9;
+            /// Rates over the intervals since the first arrival, which the
+            /// first buffer doesn't belong to.
+            stats.buffers_per_second = double(stats.buffers - 1) / seconds;
+            stats.bytes_per_second = double(stats.bytes - first_bytes_.load(std::memory_order_relaxed)) / seconds;
+        }
+        stats.jitter_us = double(jitter_ns_.load(std::memory_order_relaxed)) / 1e3;
+        stats.max_callback_us = max_us_.load(std::memory_order_relaxed);
+        for (std::size_t i = 0; i < Port_stats::histogram_buckets; ++i)
+            stats.callback_us_histogram[i] = histogram_[i].load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Reset every counter. Not synchronised with the recording threads.
+     */
+    void
+    reset()
+    {
+        buffers_ = 0;
+        bytes_ = 0;
+        first_bytes_ = 0;
+        first_ns_ = 0;
+        last_ns_ = 0;
+        interval_ns_ = 0;
+        jitter_ns_ = 0;
+        max_us_ = 0;
+        for (std::atomic<uint64_t>& h : histogram_)
+            h = 0;
+    }
+
+private:
+    std::atomic<uint64_t> buffers_{0};
+    std::atomic<uint64_t> bytes_{0};
+    std::atomic<uint64_t> first_bytes_{0};
+    std::atomic<int64_t> first_ns_{0};
+    std::atomic<int64_t> last_ns_{0};
+    std::atomic<int64_t> interval_ns_{0};
+    std::atomic<int64_t> jitter_ns_{0};
+    std::atomic<uint64_t> max_us_{0};
+    std::array<std::atomic<uint64_t>, Port_stats::histogram_buckets> histogram_{};
+
+};
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_STATS_H
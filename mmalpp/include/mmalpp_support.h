@@ -30,6 +30,7 @@ template <typename P_>
 void
 close_single_(P_& port_)
 {
+    port_.wait_reconfigure();
     if (!port_.is_null() && port_.is_enabled()) {
         port_.disable();
         port_.flush();
@@ -58,12 +59,58 @@ void
 disconnect_ports_(P_& ports_)
 {
     for (auto& p : ports_)
-        if (!p.is_null() && p.is_enabled())
-            if (!p.connection().is_null()) {
-                if (p.connection().is_enabled())
-                    p.connection().disable();
-                p.connection().release();
-            }
+        if (!p.is_null() && p.is_connected()) {
+            if (p.connection().is_enabled())
+                p.connection().disable();
+            p.connection().release();
+        }
+}
+
+/**
+ * Disconnect all input ports in a container from their sources.
+ */
+template <typename P_>
+void
+disconnect_inputs_(P_& ports_)
+{
+    for (auto& p : ports_)
+        if (p.connection_ && !p.connection_->is_null()) {
+            if (p.connection_->is_enabled())
+                p.connection_->disable();
+            p.connection_->release();
+        }
+}
+
+/**
+ * Bring a port back to its state after creation: disable and flush it, release
+ * its Pool and clear its handlers, caches and counters. The format committed
+ * on VideoCore is kept.
+ */
+template <typename P_>
+void
+reset_single_(P_& port_)
+{
+    if (port_.is_null())
+        return;
+    port_.wait_reconfigure();
+    if (port_.is_enabled()) {
+        port_.disable();
+        port_.flush();
+    }
+    if (!port_.pool().is_null())
+        port_.release_pool();
+    port_.clear_handlers();
+}
+
+/**
+ * Reset all ports in a container.
+ */
+template <typename P_>
+void
+reset_(P_& ports_)
+{
+    for (auto& p : ports_)
+        reset_single_(p);
 }
 
 };
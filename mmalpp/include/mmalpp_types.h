@@ -13,6 +13,25 @@ enum PORT_TYPE {
     CONTROL
 };
 
+/// Policies of a full callback queue
+enum OVERFLOW_POLICY {
+    DROP_OLDEST,
+    DROP_NEWEST,
+    BLOCK
+};
+
+/// Paths of a Buffer released to a Pool with a release callback
+enum RELEASE_MODE {
+    RECYCLE_DIRECT,
+    RECYCLE_QUEUED
+};
+
+/// What a connection tap does with a Buffer
+enum TAP_ACTION {
+    FORWARD,
+    DROP
+};
+
 MMALPP_END
 
 #endif // MMALPP_TYPES_H
@@ -55,29 +55,31 @@ replicate_buffer_header_ (MMAL_BUFFER_HEADER_T* buffer_src_,
                 buffer_dst_, buffer_src_); status)
         e_check__(status, "cannot replicate a buffer"); }
 
-/// ************************************ NOT IMPLEMENTED ************************************  ///
-/// *****************************************************************************************  ///
+/**
+ * Continue the buffer header release process. This should be called to complete buffer
+ * header recycling once all pre-release activity has been completed.
+ */
+inline void
+buffer_header_continue_release_(MMAL_BUFFER_HEADER_T* buffer_)
+{ mmal_buffer_header_release_continue(buffer_); }
 
-///**
-// * Continue the buffer header release process. This should be called to complete buffer
-// * header recycling once all pre-release activity has been completed.
-// */
-//void
-//buffer_header_continue_release_(MMAL_BUFFER_HEADER_T* buffer_)
-//{ mmal_buffer_header_release_continue(buffer_); }
+/**
+ * Set a buffer header pre-release callback. If the callback is NULL, the buffer
+ * will be released back into the pool immediately as usual.
+ * The callback is invoked just before a buffer is released back into a pool.
+ * This is used by clients who need to trigger additional actions before the buffer
+ * can finally be released (e.g. wait for a bulk transfer to complete).
+ * If the callback returns MMAL_TRUE the release is postponed until
+ * mmal_buffer_header_release_continue is called.
+ */
+inline void
+buffer_header_set_callback_(MMAL_BUFFER_HEADER_T* buffer_,
+                            MMAL_BH_PRE_RELEASE_CB_T cb_,
+                            void* userdata_)
+{ mmal_buffer_header_pre_release_cb_set(buffer_, cb_, userdata_); }
 
-///**
-// * Set a buffer header pre-release callback. If the callback is NULL, the buffer
-// * will be released back into the pool immediately as usual.
-// * The callback is invoked just before a buffer is released back into a pool.
-// * This is used by clients who need to trigger additional actions before the buffer
-// * can finally be released (e.g. wait for a bulk transfer to complete).
-// */
-//void
-//buffer_header_set_callback_(MMAL_BUFFER_HEADER_T* buffer_,
-//                            MMAL_BH_PRE_RELEASE_CB_T cb_,
-//                            void* userdata_)
-//{ mmal_buffer_header_pre_release_cb_set(buffer_, cb_, userdata_); }
+/// ************************************ NOT IMPLEMENTED ************************************  ///
+/// *****************************************************************************************  ///
 
 ///**
 // * Lock the data buffer contained in the buffer header in memory. This call does nothing
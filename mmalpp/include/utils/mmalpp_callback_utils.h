@@ -0,0 +1,100 @@
+#ifndef MMALPP_CALLBACK_UTILS_H
+#define MMALPP_CALLBACK_UTILS_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include "../../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/**
+ * Storage for a callable of any type. Callables up to capacity_ bytes are stored
+ * inline, bigger ones are allocated once when stored. The storage doesn't know
+ * how to call what it holds: the owner keeps the callable type (e.g. in a callback
+ * trampoline instantiated for it) and gets it back with get<F_>(), so calls are
+ * statically dispatched and can be inlined.
+ */
+class Callback_storage_ {
+
+public:
+
+    static constexpr std::size_t capacity_ = 64;
+
+    Callback_storage_() noexcept = default;
+    Callback_storage_(const Callback_storage_&) = delete;
+    Callback_storage_& operator=(const Callback_storage_&) = delete;
+
+    ~Callback_storage_()
+    { reset(); }
+
+    /**
+     * Store a callable, destroying the previous one.
+     */
+    template <typename F_>
+    std::decay_t<F_>&
+    emplace(F_&& f_)
+    {
+        using type_ = std::decay_t<F_>;
+        reset();
+        if constexpr (is_inline_<type_>()) {
+            ::new (static_cast<void*>(buf_)) type_(std::forward<F_>(f_));
+            destroy_ = [] (unsigned char* buf) { std::launder(reinterpret_cast<type_*>(buf))->~type_(); };
+        } else {
+            ::new (static_cast<void*>(buf_)) type_*(new type_(std::forward<F_>(f_)));
+            destroy_ = [] (unsigned char* buf) { delete *std::launder(reinterpret_cast<type_**>(buf)); };
+        }
+        return get<type_>();
+    }
+
+    /**
+     * Get the stored callable. F_ must be the type it was stored with.
+     */
+    template <typename F_>
+    F_&
+    get() noexcept
+    {
+        if constexpr (is_inline_<F_>())
+            return *std::launder(reinterpret_cast<F_*>(buf_));
+        return **std::launder(reinterpret_cast<F_**>(buf_));
+    }
+
+    /**
+     * Destroy the stored callable.
+     */
+    void
+    reset() noexcept
+    {
+        if (destroy_) {
+            destroy_(buf_);
+            destroy_ = nullptr;
+        }
+    }
+
+    /**
+     * Check if a callable is stored.
+     */
+    bool
+    empty() const noexcept
+    { return destroy_ == nullptr; }
+
+private:
+    alignas(std::max_align_t) unsigned char buf_[capacity_];
+    void (*destroy_)(unsigned char*) = nullptr;
+
+    template <typename F_>
+    static constexpr bool
+    is_inline_()
+    { return sizeof(F_) <= capacity_ && alignof(F_) <= alignof(std::max_align_t); }
+
+};
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_CALLBACK_UTILS_H
@@ -0,0 +1,524 @@
+#ifndef MMALPP_CONVERT_UTILS_H
+#define MMALPP_CONVERT_UTILS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MMALPP_CONVERT_NEON
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define MMALPP_CONVERT_SSE2
+#endif
+
+#include "../../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/// These kernels don't depend on MMAL: they work on raw planes, so they can be
+/// built and benchmarked on any host. Every SIMD kernel has a scalar reference
+/// with the same fixed-point math, so results are bit-exact between them.
+///
+/// YUV to RGB uses BT.601 limited range, with 7 bits of precision for luma
+/// and 6 bits for chroma:
+///   Y' = (149 * max(Y - 16, 0) + 64) >> 7
+///   R  = Y' + ((102 * (V - 128) + 32) >> 6)
+///   G  = Y' - ((25 * (U - 128) + 52 * (V - 128) + 32) >> 6)
+///   B  = Y' + ((129 * (U - 128) + 32) >> 6)
+/// Every intermediate value fits in 16 bits (luma ones are unsigned).
+
+/// Byte order of packed RGB destinations.
+enum class Pixel_order_ {
+    RGB24,
+    BGR24,
+    RGBA,
+    BGRA
+};
+
+/// Bytes per pixel of a packed RGB destination.
+constexpr std::size_t
+pixel_bytes_(Pixel_order_ o_)
+{ return (o_ == Pixel_order_::RGB24 || o_ == Pixel_order_::BGR24) ? 3 : 4; }
+
+/// Check if blue comes first.
+constexpr bool
+is_bgr_(Pixel_order_ o_)
+{ return o_ == Pixel_order_::BGR24 || o_ == Pixel_order_::BGRA; }
+
+namespace scalar_ {
+
+inline uint8_t
+clamp_(int v_)
+{ return uint8_t(v_ < 0 ? 0 : (v_ > 255 ? 255 : v_)); }
+
+/**
+ * Convert pixels [x_, width_) of a 4:2:0 row to packed RGB.
+ * If Nv_ is true u_ points at the interleaved UV row and v_ is ignored.
+ */
+template <Pixel_order_ O_, bool Nv_>
+inline void
+yuv_row_(const uint8_t* y_, const uint8_t* u_, const uint8_t* v_,
+         uint8_t* dst_, uint32_t x_, uint32_t width_)
+{
+    for (; x_ < width_; ++x_) {
+        const uint32_t c_ = x_ / 2;
+        const int d = int(Nv_ ? u_[2 * c_] : u_[c_]) - 128;
+        const int e = int(Nv_ ? u_[2 * c_ + 1] : v_[c_]) - 128;
+        const int c = int(y_[x_]) - 16;
+        const int yy = (149 * (c < 0 ? 0 : c) + 64) >> 7;
+        const uint8_t r = clamp_(yy + ((102 * e + 32) >> 6));
+        const uint8_t g = clamp_(yy - ((25 * d + 52 * e + 32) >> 6));
+        const uint8_t b = clamp_(yy + ((129 * d + 32) >> 6));
+        uint8_t* p = dst_ + std::size_t(x_) * pixel_bytes_(O_);
+        p[0] = is_bgr_(O_) ? b : r;
+        p[1] = g;
+        p[2] = is_bgr_(O_) ? r : b;
+        if (pixel_bytes_(O_) == 4)
+            p[3] = 255;
+    }
+}
+
+/**
+ * Interleave samples [x_, n_) of U and V rows into a UV row.
+ */
+inline void
+interleave_row_(const uint8_t* u_, const uint8_t* v_, uint8_t* uv_,
+                uint32_t x_, uint32_t n_)
+{
+    for (; x_ < n_; ++x_) {
+        uv_[2 * x_] = u_[x_];
+        uv_[2 * x_ + 1] = v_[x_];
+    }
+}
+
+/**
+ * Split samples [x_, n_) of a UV row into U and V rows.
+ */
+inline void
+deinterleave_row_(const uint8_t* uv_, uint8_t* u_, uint8_t* v_,
+                  uint32_t x_, uint32_t n_)
+{
+    for (; x_ < n_; ++x_) {
+        u_[x_] = uv_[2 * x_];
+        v_[x_] = uv_[2 * x_ + 1];
+    }
+}
+
+/**
+ * Convert pixels [x_, width_) of two YUYV rows to two Y rows and one U and V row.
+ * Chroma is the rounded average of the two rows.
+ */
+inline void
+yuyv_rows_(const uint8_t* r0_, const uint8_t* r1_, uint8_t* y0_, uint8_t* y1_,
+           uint8_t* u_, uint8_t* v_, uint32_t x_, uint32_t width_)
+{
+    for (; x_ < width_; ++x_) {
+        y0_[x_] = r0_[2 * x_];
+        y1_[x_] = r1_[2 * x_];
+        if ((x_ & 1) == 0) {
+            const std::size_t m = std::size_t(x_) * 2;
+            u_[x_ / 2] = uint8_t((r0_[m + 1] + r1_[m + 1] + 1) >> 1);
+            v_[x_ / 2] = uint8_t((r0_[m + 3] + r1_[m + 3] + 1) >> 1);
+        }
+    }
+}
+
+};
+
+namespace simd_ {
+
+/// Every kernel processes as many pixels as possible with vectors and lets
+/// the scalar reference finish the row. Without SIMD support they are the
+/// scalar reference.
+
+#if defined(MMALPP_CONVERT_SSE2)
+
+/// Store 16 pixels given as R, G, B vectors.
+template <Pixel_order_ O_>
+inline void
+store_pixels_(uint8_t* dst_, __m128i r_, __m128i g_, __m128i b_)
+{
+    const __m128i c0 = is_bgr_(O_) ? b_ : r_;
+    const __m128i c2 = is_bgr_(O_) ? r_ : b_;
+    const __m128i a = _mm_set1_epi8(char(0xFF));
+    const __m128i lo01 = _mm_unpacklo_epi8(c0, g_);
+    const __m128i hi01 = _mm_unpackhi_epi8(c0, g_);
+    const __m128i lo2a = _mm_unpacklo_epi8(c2, a);
+    const __m128i hi2a = _mm_unpackhi_epi8(c2, a);
+    __m128i px[4] = {_mm_unpacklo_epi16(lo01, lo2a), _mm_unpackhi_epi16(lo01, lo2a),
+                     _mm_unpacklo_epi16(hi01, hi2a), _mm_unpackhi_epi16(hi01, hi2a)};
+    if (pixel_bytes_(O_) == 4) {
+        for (int i = 0; i < 4; ++i)
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ + 16 * i), px[i]);
+        return;
+    }
+    /// Drop the alpha byte: pack each pair of 3-byte pixels in a 64-bit lane,
+    /// then join the two lanes into 12 contiguous bytes.
+    const __m128i rgb_mask = _mm_set1_epi32(0x00FFFFFF);
+    const __m128i lo_mask = _mm_set_epi32(0, 0x00FFFFFF, 0, 0x00FFFFFF);
+    const __m128i lane0 = _mm_set_epi32(0, 0, -1, -1);
+    const __m128i lane1 = _mm_set_epi32(-1, -1, 0, 0);
+    for (int i = 0; i < 4; ++i) {
+        const __m128i p = _mm_and_si128(px[i], rgb_mask);
+        const __m128i t = _mm_or_si128(_mm_and_si128(p, lo_mask),
+                                       _mm_srli_epi64(_mm_andnot_si128(lo_mask, p), 8));
+        px[i] = _mm_or_si128(_mm_and_si128(t, lane0),
+                             _mm_srli_si128(_mm_and_si128(t, lane1), 2));
+    }
+    /// Each store overwrites the 4 spare bytes of the previous one.
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_), px[0]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ + 12), px[1]);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst_ + 24), px[2]);
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(dst_ + 36), px[3]);
+    const int tail = _mm_cvtsi128_si32(_mm_srli_si128(px[3], 8));
+    std::memcpy(dst_ + 44, &tail, 4);
+}
+
+template <Pixel_order_ O_, bool Nv_>
+inline void
+yuv_row_(const uint8_t* y_, const uint8_t* u_, const uint8_t* v_,
+         uint8_t* dst_, uint32_t width_)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i c16 = _mm_set1_epi8(16);
+    const __m128i c64 = _mm_set1_epi16(64);
+    const __m128i c32 = _mm_set1_epi16(32);
+    const __m128i c128 = _mm_set1_epi16(128);
+    uint32_t x = 0;
+    for (; x + 16 <= width_; x += 16) {
+        __m128i u8, v8;
+        if (Nv_) {
+            const __m128i uv = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u_ + x));
+            u8 = _mm_and_si128(uv, mask);
+            v8 = _mm_srli_epi16(uv, 8);
+        } else {
+            u8 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(u_ + x / 2)), zero);
+            v8 = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(v_ + x / 2)), zero);
+        }
+        const __m128i d = _mm_sub_epi16(u8, c128);
+        const __m128i e = _mm_sub_epi16(v8, c128);
+        const __m128i rt = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(e, _mm_set1_epi16(102)), c32), 6);
+        const __m128i gt = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(25)),
+                                                                      _mm_mullo_epi16(e, _mm_set1_epi16(52))), c32), 6);
+        const __m128i bt = _mm_srai_epi16(_mm_add_epi16(_mm_mullo_epi16(d, _mm_set1_epi16(129)), c32), 6);
+
+        const __m128i c8 = _mm_subs_epu8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(y_ + x)), c16);
+        const __m128i ylo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(
+                            _mm_unpacklo_epi8(c8, zero), _mm_set1_epi16(149)), c64), 7);
+        const __m128i yhi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(
+                            _mm_unpackhi_epi8(c8, zero), _mm_set1_epi16(149)), c64), 7);
+
+        const __m128i r = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(rt, rt)),
+                                           _mm_add_epi16(yhi, _mm_unpackhi_epi16(rt, rt)));
+        const __m128i g = _mm_packus_epi16(_mm_sub_epi16(ylo, _mm_unpacklo_epi16(gt, gt)),
+                                           _mm_sub_epi16(yhi, _mm_unpackhi_epi16(gt, gt)));
+        const __m128i b = _mm_packus_epi16(_mm_add_epi16(ylo, _mm_unpacklo_epi16(bt, bt)),
+                                           _mm_add_epi16(yhi, _mm_unpackhi_epi16(bt, bt)));
+        store_pixels_<O_>(dst_ + std::size_t(x) * pixel_bytes_(O_), r, g, b);
+    }
+    scalar_::yuv_row_<O_, Nv_>(y_, u_, v_, dst_, x, width_);
+}
+
+inline void
+interleave_row_(const uint8_t* u_, const uint8_t* v_, uint8_t* uv_, uint32_t n_)
+{
+    uint32_t x = 0;
+    for (; x + 16 <= n_; x += 16) {
+        const __m128i u = _mm_loadu_si128(reinterpret_cast<const __m128i*>(u_ + x));
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(v_ + x));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv_ + 2 * x), _mm_unpacklo_epi8(u, v));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(uv_ + 2 * x + 16), _mm_unpackhi_epi8(u, v));
+    }
+    scalar_::interleave_row_(u_, v_, uv_, x, n_);
+}
+
+inline void
+deinterleave_row_(const uint8_t* uv_, uint8_t* u_, uint8_t* v_, uint32_t n_)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    uint32_t x = 0;
+    for (; x + 16 <= n_; x += 16) {
+        const __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv_ + 2 * x));
+        const __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(uv_ + 2 * x + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(u_ + x),
+                         _mm_packus_epi16(_mm_and_si128(a, mask), _mm_and_si128(b, mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(v_ + x),
+                         _mm_packus_epi16(_mm_srli_epi16(a, 8), _mm_srli_epi16(b, 8)));
+    }
+    scalar_::deinterleave_row_(uv_, u_, v_, x, n_);
+}
+
+inline void
+yuyv_rows_(const uint8_t* r0_, const uint8_t* r1_, uint8_t* y0_, uint8_t* y1_,
+           uint8_t* u_, uint8_t* v_, uint32_t width_)
+{
+    const __m128i mask = _mm_set1_epi16(0x00FF);
+    const __m128i zero = _mm_setzero_si128();
+    uint32_t x = 0;
+    for (; x + 16 <= width_; x += 16) {
+        const __m128i a0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0_ + 2 * x));
+        const __m128i a1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r0_ + 2 * x + 16));
+        const __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1_ + 2 * x));
+        const __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(r1_ + 2 * x + 16));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y0_ + x),
+                         _mm_packus_epi16(_mm_and_si128(a0, mask), _mm_and_si128(a1, mask)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(y1_ + x),
+                         _mm_packus_epi16(_mm_and_si128(b0, mask), _mm_and_si128(b1, mask)));
+        const __m128i c = _mm_avg_epu8(_mm_packus_epi16(_mm_srli_epi16(a0, 8), _mm_srli_epi16(a1, 8)),
+                                       _mm_packus_epi16(_mm_srli_epi16(b0, 8), _mm_srli_epi16(b1, 8)));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(u_ + x / 2),
+                         _mm_packus_epi16(_mm_and_si128(c, mask), zero));
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(v_ + x / 2),
+                         _mm_packus_epi16(_mm_srli_epi16(c, 8), zero));
+    }
+    scalar_::yuyv_rows_(r0_, r1_, y0_, y1_, u_, v_, x, width_);
+}
+
+#elif defined(MMALPP_CONVERT_NEON)
+
+template <Pixel_order_ O_, bool Nv_>
+inline void
+yuv_row_(const uint8_t* y_, const uint8_t* u_, const uint8_t* v_,
+         uint8_t* dst_, uint32_t width_)
+{
+    const int16x8_t c32 = vdupq_n_s16(32);
+    uint32_t x = 0;
+    for (; x + 16 <= width_; x += 16) {
+        uint8x8_t u8, v8;
+        if (Nv_) {
+            const uint8x8x2_t uv = vld2_u8(u_ + x);
+            u8 = uv.val[0];
+            v8 = uv.val[1];
+        } else {
+            u8 = vld1_u8(u_ + x / 2);
+            v8 = vld1_u8(v_ + x / 2);
+        }
+        const int16x8_t d = vreinterpretq_s16_u16(vsubl_u8(u8, vdup_n_u8(128)));
+        const int16x8_t e = vreinterpretq_s16_u16(vsubl_u8(v8, vdup_n_u8(128)));
+        const int16x8_t rt = vshrq_n_s16(vaddq_s16(vmulq_n_s16(e, 102), c32), 6);
+        const int16x8_t gt = vshrq_n_s16(vaddq_s16(vmlaq_n_s16(vmulq_n_s16(d, 25), e, 52), c32), 6);
+        const int16x8_t bt = vshrq_n_s16(vaddq_s16(vmulq_n_s16(d, 129), c32), 6);
+        const int16x8x2_t rz = vzipq_s16(rt, rt);
+        const int16x8x2_t gz = vzipq_s16(gt, gt);
+        const int16x8x2_t bz = vzipq_s16(bt, bt);
+
+        const uint8x16_t c8 = vqsubq_u8(vld1q_u8(y_ + x), vdupq_n_u8(16));
+        const uint16x8_t c64 = vdupq_n_u16(64);
+        const int16x8_t ylo = vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(
+                              vmull_u8(vget_low_u8(c8), vdup_n_u8(149)), c64), 7));
+        const int16x8_t yhi = vreinterpretq_s16_u16(vshrq_n_u16(vaddq_u16(
+                              vmull_u8(vget_high_u8(c8), vdup_n_u8(149)), c64), 7));
+
+        const uint8x16_t r = vcombine_u8(vqmovun_s16(vaddq_s16(ylo, rz.val[0])),
+                                         vqmovun_s16(vaddq_s16(yhi, rz.val[1])));
+        const uint8x16_t g = vcombine_u8(vqmovun_s16(vsubq_s16(ylo, gz.val[0])),
+                                         vqmovun_s16(vsubq_s16(yhi, gz.val[1])));
+        const uint8x16_t b = vcombine_u8(vqmovun_s16(vaddq_s16(ylo, bz.val[0])),
+                                         vqmovun_s16(vaddq_s16(yhi, bz.val[1])));
+        uint8_t* p = dst_ + std::size_t(x) * pixel_bytes_(O_);
+        if (pixel_bytes_(O_) == 3) {
+            const uint8x16x3_t px = {{is_bgr_(O_) ? b : r, g, is_bgr_(O_) ? r : b}};
+            vst3q_u8(p, px);
+        } else {
+            const uint8x16x4_t px = {{is_bgr_(O_) ? b : r, g, is_bgr_(O_) ? r : b, vdupq_n_u8(255)}};
+            vst4q_u8(p, px);
+        }
+    }
+    scalar_::yuv_row_<O_, Nv_>(y_, u_, v_, dst_, x, width_);
+}
+
+inline void
+interleave_row_(const uint8_t* u_, const uint8_t* v_, uint8_t* uv_, uint32_t n_)
+{
+    uint32_t x = 0;
+    for (; x + 16 <= n_; x += 16) {
+        const uint8x16x2_t uv = {{vld1q_u8(u_ + x), vld1q_u8(v_ + x)}};
+        vst2q_u8(uv_ + 2 * x, uv);
+    }
+    scalar_::interleave_row_(u_, v_, uv_, x, n_);
+}
+
+inline void
+deinterleave_row_(const uint8_t* uv_, uint8_t* u_, uint8_t* v_, uint32_t n_)
+{
+    uint32_t x = 0;
+    for (; x + 16 <= n_; x += 16) {
+        const uint8x16x2_t uv = vld2q_u8(uv_ + 2 * x);
+        vst1q_u8(u_ + x, uv.val[0]);
+        vst1q_u8(v_ + x, uv.val[1]);
+    }
+    scalar_::deinterleave_row_(uv_, u_, v_, x, n_);
+}
+
+inline void
+yuyv_rows_(const uint8_t* r0_, const uint8_t* r1_, uint8_t* y0_, uint8_t* y1_,
+           uint8_t* u_, uint8_t* v_, uint32_t width_)
+{
+    uint32_t x = 0;
+    for (; x + 32 <= width_; x += 32) {
+        const uint8x16x4_t a = vld4q_u8(r0_ + 2 * x);
+        const uint8x16x4_t b = vld4q_u8(r1_ + 2 * x);
+        const uint8x16x2_t ya = {{a.val[0], a.val[2]}};
+        const uint8x16x2_t yb = {{b.val[0], b.val[2]}};
+        vst2q_u8(y0_ + x, ya);
+        vst2q_u8(y1_ + x, yb);
+        vst1q_u8(u_ + x / 2, vrhaddq_u8(a.val[1], b.val[1]));
+        vst1q_u8(v_ + x / 2, vrhaddq_u8(a.val[3], b.val[3]));
+    }
+    scalar_::yuyv_rows_(r0_, r1_, y0_, y1_, u_, v_, x, width_);
+}
+
+#else
+
+template <Pixel_order_ O_, bool Nv_>
+inline void
+yuv_row_(const uint8_t* y_, const uint8_t* u_, const uint8_t* v_,
+         uint8_t* dst_, uint32_t width_)
+{ scalar_::yuv_row_<O_, Nv_>(y_, u_, v_, dst_, 0, width_); }
+
+inline void
+interleave_row_(const uint8_t* u_, const uint8_t* v_, uint8_t* uv_, uint32_t n_)
+{ scalar_::interleave_row_(u_, v_, uv_, 0, n_); }
+
+inline void
+deinterleave_row_(const uint8_t* uv_, uint8_t* u_, uint8_t* v_, uint32_t n_)
+{ scalar_::deinterleave_row_(uv_, u_, v_, 0, n_); }
+
+inline void
+yuyv_rows_(const uint8_t* r0_, const uint8_t* r1_, uint8_t* y0_, uint8_t* y1_,
+           uint8_t* u_, uint8_t* v_, uint32_t width_)
+{ scalar_::yuyv_rows_(r0_, r1_, y0_, y1_, u_, v_, 0, width_); }
+
+#endif
+
+};
+
+/// Name of the SIMD instruction set used by the kernels.
+inline const char*
+convert_isa_()
+{
+#if defined(MMALPP_CONVERT_SSE2)
+    return "SSE2";
+#elif defined(MMALPP_CONVERT_NEON)
+    return "NEON";
+#else
+    return "scalar";
+#endif
+}
+
+/**
+ * Copy a plane of width_ bytes and height_ rows.
+ */
+inline void
+copy_plane_(const uint8_t* src_, std::ptrdiff_t src_stride_,
+            uint8_t* dst_, std::ptrdiff_t dst_stride_,
+            uint32_t width_, uint32_t height_)
+{
+    if (src_stride_ == dst_stride_ && std::ptrdiff_t(width_) == src_stride_) {
+        std::memcpy(dst_, src_, std::size_t(width_) * height_);
+        return;
+    }
+    for (uint32_t r = 0; r < height_; ++r)
+        std::memcpy(dst_ + r * dst_stride_, src_ + r * src_stride_, width_);
+}
+
+/**
+ * Convert a 4:2:0 frame (I420, or NV12 if Nv_ is true) to packed RGB.
+ * For NV12 u_ is the UV plane and v_ is ignored. Simd_ selects the SIMD kernels
+ * or the scalar reference.
+ */
+template <Pixel_order_ O_, bool Nv_, bool Simd_ = true>
+inline void
+yuv420_to_packed_(const uint8_t* y_, std::ptrdiff_t y_stride_,
+                  const uint8_t* u_, std::ptrdiff_t u_stride_,
+                  const uint8_t* v_, std::ptrdiff_t v_stride_,
+                  uint8_t* dst_, std::ptrdiff_t dst_stride_,
+                  uint32_t width_, uint32_t height_)
+{
+    for (uint32_t r = 0; r < height_; ++r) {
+        const uint8_t* y = y_ + r * y_stride_;
+        const uint8_t* u = u_ + (r / 2) * u_stride_;
+        const uint8_t* v = Nv_ ? u : v_ + (r / 2) * v_stride_;
+        uint8_t* d = dst_ + r * dst_stride_;
+        if (Simd_)
+            simd_::yuv_row_<O_, Nv_>(y, u, v, d, width_);
+        else
+            scalar_::yuv_row_<O_, Nv_>(y, u, v, d, 0, width_);
+    }
+}
+
+/**
+ * Convert the chroma planes of a I420 frame to the UV plane of a NV12 frame.
+ * width_ and height_ are the size of the chroma planes.
+ */
+template <bool Simd_ = true>
+inline void
+i420_to_nv12_chroma_(const uint8_t* u_, std::ptrdiff_t u_stride_,
+                     const uint8_t* v_, std::ptrdiff_t v_stride_,
+                     uint8_t* uv_, std::ptrdiff_t uv_stride_,
+                     uint32_t width_, uint32_t height_)
+{
+    for (uint32_t r = 0; r < height_; ++r) {
+        if (Simd_)
+            simd_::interleave_row_(u_ + r * u_stride_, v_ + r * v_stride_, uv_ + r * uv_stride_, width_);
+        else
+            scalar_::interleave_row_(u_ + r * u_stride_, v_ + r * v_stride_, uv_ + r * uv_stride_, 0, width_);
+    }
+}
+
+/**
+ * Convert the UV plane of a NV12 frame to the chroma planes of a I420 frame.
+ * width_ and height_ are the size of the chroma planes.
+ */
+template <bool Simd_ = true>
+inline void
+nv12_to_i420_chroma_(const uint8_t* uv_, std::ptrdiff_t uv_stride_,
+                     uint8_t* u_, std::ptrdiff_t u_stride_,
+                     uint8_t* v_, std::ptrdiff_t v_stride_,
+                     uint32_t width_, uint32_t height_)
+{
+    for (uint32_t r = 0; r < height_; ++r) {
+        if (Simd_)
+            simd_::deinterleave_row_(uv_ + r * uv_stride_, u_ + r * u_stride_, v_ + r * v_stride_, width_);
+        else
+            scalar_::deinterleave_row_(uv_ + r * uv_stride_, u_ + r * u_stride_, v_ + r * v_stride_, 0, width_);
+    }
+}
+
+/**
+ * Convert a YUYV frame to a I420 frame. Chroma of each pair of rows is averaged.
+ */
+template <bool Simd_ = true>
+inline void
+yuyv_to_i420_(const uint8_t* src_, std::ptrdiff_t src_stride_,
+              uint8_t* y_, std::ptrdiff_t y_stride_,
+              uint8_t* u_, std::ptrdiff_t u_stride_,
+              uint8_t* v_, std::ptrdiff_t v_stride_,
+              uint32_t width_, uint32_t height_)
+{
+    for (uint32_t r = 0; r < height_; r += 2) {
+        /// With an odd height the last row is paired with itself.
+        const uint32_t r1 = (r + 1 < height_) ? r + 1 : r;
+        const uint8_t* s0 = src_ + r * src_stride_;
+        const uint8_t* s1 = src_ + r1 * src_stride_;
+        uint8_t* y0 = y_ + r * y_stride_;
+        uint8_t* y1 = y_ + r1 * y_stride_;
+        uint8_t* u = u_ + (r / 2) * u_stride_;
+        uint8_t* v = v_ + (r / 2) * v_stride_;
+        if (Simd_)
+            simd_::yuyv_rows_(s0, s1, y0, y1, u, v, width_);
+        else
+            scalar_::yuyv_rows_(s0, s1, y0, y1, u, v, 0, width_);
+    }
+}
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_CONVERT_UTILS_H
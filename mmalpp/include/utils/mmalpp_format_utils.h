@@ -0,0 +1,55 @@
+#ifndef MMALPP_FORMAT_UTILS_H
+#define MMALPP_FORMAT_UTILS_H
+
+#include <interface/mmal/mmal_types.h>
+#include <interface/mmal/mmal_format.h>
+
+#include "exceptions/mmalpp_exceptions.h"
+#include "../../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/**
+ * Allocate and initialise a MMAL_ES_FORMAT_T structure.
+ */
+inline MMAL_ES_FORMAT_T*
+alloc_format_()
+{ return mmal_format_alloc(); }
+
+/**
+ * Free a MMAL_ES_FORMAT_T structure previously allocated with alloc_format_().
+ */
+inline void
+free_format_(MMAL_ES_FORMAT_T* format_)
+{ mmal_format_free(format_); }
+
+/**
+ * Fully copy a format structure, including the extradata buffer.
+ */
+inline void
+full_copy_format_(MMAL_ES_FORMAT_T* src_, MMAL_ES_FORMAT_T* dst_)
+{ if (MMAL_STATUS_T status = mmal_format_full_copy(dst_, src_); status)
+        e_check__(status, "cannot copy format"); }
+
+/**
+ * Fully copy a format structure. It returns the status instead of throwing.
+ */
+inline MMAL_STATUS_T
+try_full_copy_format_(MMAL_ES_FORMAT_T* src_, MMAL_ES_FORMAT_T* dst_) noexcept
+{ return mmal_format_full_copy(dst_, src_); }
+
+/**
+ * Compare two formats. It returns 0 if they are the same, otherwise
+ * a set of MMAL_ES_FORMAT_COMPARE_FLAG_* telling what differs.
+ */
+inline uint32_t
+compare_format_(MMAL_ES_FORMAT_T* a_, MMAL_ES_FORMAT_T* b_)
+{ return mmal_format_compare(a_, b_); }
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_FORMAT_UTILS_H
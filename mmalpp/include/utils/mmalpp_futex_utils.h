@@ -0,0 +1,138 @@
+#ifndef MMALPP_FUTEX_UTILS_H
+#define MMALPP_FUTEX_UTILS_H
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t)
+              && std::atomic<uint32_t>::is_always_lock_free,
+              "futex words must be plain 32 bit integers");
+
+/**
+ * Sleep while word is equal to expected, up to timeout_ms (forever if it is
+ * less than 0). It can return early, so the caller has to check its condition again.
+ */
+inline void
+futex_wait_(std::atomic<uint32_t>& word_, uint32_t expected_, int timeout_ms_)
+{
+    timespec timeout;
+    timespec* timeout_ptr = nullptr;
+    if (timeout_ms_ >= 0) {
+        timeout.tv_sec = timeout_ms_ / 1000;
+        timeout.tv_nsec = long(timeout_ms_ % 1000) * 1000000;
+        timeout_ptr = &timeout;
+    }
+    syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word_), FUTEX_WAIT_PRIVATE,
+            expected_, timeout_ptr, nullptr, 0);
+}
+
+/**
+ * Wake up to count threads sleeping on word.
+ */
+inline void
+futex_wake_(std::atomic<uint32_t>& word_, int count_)
+{ syscall(SYS_futex, reinterpret_cast<uint32_t*>(&word_), FUTEX_WAKE_PRIVATE,
+          count_, nullptr, nullptr, 0); }
+
+/**
+ * Event on which threads wait for a condition checked by the caller (an item
+ * in a ring, room in it, ...), an eventcount: the futex word holds a generation
+ * and a bit telling that somebody sleeps. notify() only bumps the generation and
+ * makes the wake up system call when the bit is set, so it costs a fence and a
+ * load when nobody waits, and one system call per generation otherwise, however
+ * many times it is called. Every sleeper wakes up and checks its condition again.
+ */
+class Futex_event_ {
+
+public:
+
+    /**
+     * Wait until attempt() returns true, up to timeout_ms (0 tries once, less
+     * than 0 waits forever). Return the last result of attempt().
+     */
+    template <typename Attempt_>
+    bool
+    wait(int timeout_ms, Attempt_&& attempt)
+    {
+        if (attempt())
+            return true;
+        if (timeout_ms == 0)
+            return false;
+
+        /// The other side is usually a few hundred cycles away: spin a little
+        /// before paying for a sleep and a wake up.
+        for (int i = 0; i < spin_; ++i) {
+            cpu_relax_();
+            if (attempt())
+                return true;
+        }
+
+        using clock_ = std::chrono::steady_clock;
+        const clock_::time_point deadline = clock_::now() + std::chrono::milliseconds(timeout_ms);
+        for (;;) {
+            const uint32_t key = state_.fetch_or(sleeping_, std::memory_order_acq_rel) | sleeping_;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (attempt())
+                return true;
+            int left = -1;
+            if (timeout_ms > 0) {
+                const auto ms = std::chrono::ceil<std::chrono::milliseconds>(deadline - clock_::now()).count();
+                if (ms <= 0)
+                    return false;
+                left = int(ms);
+            }
+            futex_wait_(state_, key, left);
+            if (attempt())
+                return true;
+        }
+    }
+
+    /**
+     * Wake up the waiters, if any. Call it after making their condition true.
+     */
+    void
+    notify()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        uint32_t state = state_.load(std::memory_order_relaxed);
+        if ((state & sleeping_)
+                && state_.compare_exchange_strong(state, (state + 2) & ~sleeping_, std::memory_order_release))
+            futex_wake_(state_, INT_MAX);
+    }
+
+private:
+    static constexpr uint32_t sleeping_ = 1;
+    static constexpr int spin_ = 128;
+
+    std::atomic<uint32_t> state_{0};
+
+    static void
+    cpu_relax_()
+    {
+#if defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#elif defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+
+};
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_FUTEX_UTILS_H
@@ -43,6 +43,39 @@ inline MMAL_POOL_T*
 create_pool_(std::size_t headers_, uint32_t size_)
 { return mmal_pool_create(headers_, size_); }
 
+/**
+ * Create a pool of MMAL_BUFFER_HEADER_T whose payloads are allocated
+ * by the given allocator, which is also used when the pool is resized or destroyed.
+ */
+inline MMAL_POOL_T*
+create_pool_with_allocator_(std::size_t headers_,
+                            uint32_t size_,
+                            void* context_,
+                            mmal_pool_allocator_alloc_t alloc_,
+                            mmal_pool_allocator_free_t free_)
+{ return mmal_pool_create_with_allocator(headers_, size_, context_, alloc_, free_); }
+
+/**
+ * Set the callback run when a buffer header is released to the pool.
+ * If it returns MMAL_FALSE the header is not put back in the pool queue.
+ */
+inline void
+pool_set_callback_(MMAL_POOL_T* pool_,
+                   MMAL_POOL_BH_CB_T cb_,
+                   void* userdata_)
+{ mmal_pool_callback_set(pool_, cb_, userdata_); }
+
+/**
+ * Set a pre-release callback for all buffer headers in the pool.
+ * Each time a buffer header is about to be released to the pool, the callback
+ * will be triggered.
+ */
+inline void
+pool_set_pre_release_callback_(MMAL_POOL_T* pool_,
+                               MMAL_BH_PRE_RELEASE_CB_T cb_,
+                               void* userdata_)
+{ mmal_pool_pre_release_callback_set(pool_, cb_, userdata_); }
+
 };
 
 MMALPP_END
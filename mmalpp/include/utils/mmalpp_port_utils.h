@@ -57,6 +57,20 @@ commit_format_(MMAL_PORT_T* port_)
         e_check__(status, "cannot commit format on port "
                   + std::string(port_->name)); }
 
+/**
+ * Send a buffer header to a port. It returns the status instead of throwing.
+ */
+inline MMAL_STATUS_T
+try_port_send_buffer_(MMAL_PORT_T* port_, MMAL_BUFFER_HEADER_T* buffer_) noexcept
+{ return mmal_port_send_buffer(port_, buffer_); }
+
+/**
+ * Commit format changes on a port. It returns the status instead of throwing.
+ */
+inline MMAL_STATUS_T
+try_commit_format_(MMAL_PORT_T* port_) noexcept
+{ return mmal_port_format_commit(port_); }
+
 /**
  * Shallow copy a format structure. It is worth noting that the extradata buffer
  * will not be copied in the new format.
@@ -178,6 +192,127 @@ set_string_to_port_(MMAL_PORT_T* port_,
         e_check__(status, "cannot set string parameter to the port: "
                   + std::string(port_->name)); }
 
+/**
+ * Get a parameter from a port. The header must have the id and the size
+ * of the whole parameter structure.
+ */
+inline void
+get_parameters_from_port_(MMAL_PORT_T* port_,
+                          MMAL_PARAMETER_HEADER_T* param_)
+{ if (MMAL_STATUS_T status = mmal_port_parameter_get(
+                port_, param_); status)
+        e_check__(status, "cannot get parameter from the port: "
+                  + std::string(port_->name)); }
+
+/**
+ * Get a parameter from a port, returning the status instead of throwing
+ * (for parameters which not every port supports).
+ */
+inline MMAL_STATUS_T
+query_parameters_from_port_(MMAL_PORT_T* port_,
+                            MMAL_PARAMETER_HEADER_T* param_)
+{ return mmal_port_parameter_get(port_, param_); }
+
+/**
+ * Get a parameter from a port.
+ */
+inline bool
+get_boolean_from_port_(MMAL_PORT_T* port_,
+                       uint32_t id_)
+{
+    MMAL_BOOL_T value_ = MMAL_FALSE;
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_boolean(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get boolean parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Get a parameter from a port.
+ */
+inline uint64_t
+get_uint64_from_port_(MMAL_PORT_T* port_,
+                      uint32_t id_)
+{
+    uint64_t value_ = 0;
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_uint64(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get uint64_t parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Get a parameter from a port.
+ */
+inline int64_t
+get_int64_from_port_(MMAL_PORT_T* port_,
+                     uint32_t id_)
+{
+    int64_t value_ = 0;
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_int64(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get int64_t parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Get a parameter from a port.
+ */
+inline uint32_t
+get_uint32_from_port_(MMAL_PORT_T* port_,
+                      uint32_t id_)
+{
+    uint32_t value_ = 0;
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_uint32(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get uint32_t parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Get a parameter from a port.
+ */
+inline int32_t
+get_int32_from_port_(MMAL_PORT_T* port_,
+                     uint32_t id_)
+{
+    int32_t value_ = 0;
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_int32(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get int32_t parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Get a parameter from a port.
+ */
+inline MMAL_RATIONAL_T
+get_rational_from_port_(MMAL_PORT_T* port_,
+                        uint32_t id_)
+{
+    MMAL_RATIONAL_T value_ = {0, 0};
+    if (MMAL_STATUS_T status = mmal_port_parameter_get_rational(
+                port_, id_, &value_); status)
+        e_check__(status, "cannot get MMAL_RATIONAL_T parameter from the port: "
+                  + std::string(port_->name));
+    return value_;
+}
+
+/**
+ * Ask a port to use zero-copy buffers, whose payload is shared with VideoCore
+ * instead of being copied through VCHIQ. It must be done before the port is
+ * enabled and its pool created. It returns the status, since not every port
+ * supports it.
+ */
+inline MMAL_STATUS_T
+enable_zero_copy_(MMAL_PORT_T* port_)
+{ return mmal_port_parameter_set_boolean(port_, MMAL_PARAMETER_ZERO_COPY, MMAL_TRUE); }
+
 /**
  * Create a pool of MMAL_BUFFER_HEADER_T associated with a specific port.
  * This allows a client to allocate memory for the payload buffers based on the preferences
@@ -0,0 +1,225 @@
+#ifndef MMALPP_RING_UTILS_H
+#define MMALPP_RING_UTILS_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+
+#include "../../macros.h"
+
+MMALPP_BEGIN
+
+namespace mmalpp_impl_ {
+
+/// Size of a cache line, used to keep producer and consumer indexes apart.
+constexpr std::size_t cache_line_ = 64;
+
+/// Round a ring capacity up to a power of two (at least 2).
+inline std::size_t
+ring_capacity_(std::size_t n)
+{
+    std::size_t p = 2;
+    while (p < n)
+        p <<= 1;
+    return p;
+}
+
+/**
+ * Bounded lock-free multi-producer multi-consumer ring (D. Vyukov's algorithm).
+ * Every cell has a sequence number which tells whether it can be written or read
+ * at a given position, so producers and consumers only contend on their own index.
+ * The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class Mpmc_ring_ {
+
+public:
+
+    /// ctor.
+    explicit Mpmc_ring_(std::size_t capacity)
+        : capacity_(ring_capacity_(capacity)),
+          mask_(capacity_ - 1),
+          cells_(new Cell_[capacity_]),
+          head_(0),
+          tail_(0)
+    {
+        for (std::size_t i = 0; i < capacity_; ++i)
+            cells_[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    Mpmc_ring_(const Mpmc_ring_&) = delete;
+    Mpmc_ring_& operator=(const Mpmc_ring_&) = delete;
+
+    /**
+     * Push a value. Return false if the ring is full.
+     */
+    bool
+    try_push(const T& value) noexcept
+    {
+        std::size_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell_& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = value;
+                    cell.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0)
+                return false;
+            else
+                pos = head_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Pop a value. Return false if the ring is empty.
+     */
+    bool
+    try_pop(T& value) noexcept
+    {
+        std::size_t pos = tail_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell_& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.seq.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = std::ptrdiff_t(seq) - std::ptrdiff_t(pos + 1);
+            if (diff == 0) {
+                if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    value = cell.value;
+                    cell.seq.store(pos + capacity_, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0)
+                return false;
+            else
+                pos = tail_.load(std::memory_order_relaxed);
+        }
+    }
+
+    /**
+     * Get the number of values in the ring. It is exact only when no other
+     * thread is pushing or popping.
+     */
+    std::size_t
+    size() const noexcept
+    {
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    /**
+     * Get the capacity of the ring.
+     */
+    std::size_t
+    capacity() const noexcept
+    { return capacity_; }
+
+private:
+    /// One cell per cache line, so producers and consumers working on
+    /// neighbouring cells don't share a line.
+    struct alignas(cache_line_) Cell_ {
+        std::atomic<std::size_t> seq;
+        T value;
+    };
+
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<Cell_[]> cells_;
+    alignas(cache_line_) std::atomic<std::size_t> head_;
+    alignas(cache_line_) std::atomic<std::size_t> tail_;
+
+};
+
+/**
+ * Bounded lock-free single-producer single-consumer ring. Each side owns its
+ * index and keeps a cached copy of the other one on its own cache line, so the
+ * shared index is only read when the ring looks full (producer) or empty
+ * (consumer). The capacity is rounded up to a power of two.
+ */
+template <typename T>
+class Spsc_ring_ {
+
+public:
+
+    /// ctor.
+    explicit Spsc_ring_(std::size_t capacity)
+        : capacity_(ring_capacity_(capacity)),
+          mask_(capacity_ - 1),
+          values_(new T[capacity_])
+    {}
+
+    Spsc_ring_(const Spsc_ring_&) = delete;
+    Spsc_ring_& operator=(const Spsc_ring_&) = delete;
+
+    /**
+     * Push a value. Return false if the ring is full. Producer thread only.
+     */
+    bool
+    try_push(const T& value) noexcept
+    {
+        const std::size_t pos = head_.load(std::memory_order_relaxed);
+        if (pos - tail_cache_ == capacity_) {
+            tail_cache_ = tail_.load(std::memory_order_acquire);
+            if (pos - tail_cache_ == capacity_)
+                return false;
+        }
+        values_[pos & mask_] = value;
+        head_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Pop a value. Return false if the ring is empty. Consumer thread only.
+     */
+    bool
+    try_pop(T& value) noexcept
+    {
+        const std::size_t pos = tail_.load(std::memory_order_relaxed);
+        if (pos == head_cache_) {
+            head_cache_ = head_.load(std::memory_order_acquire);
+            if (pos == head_cache_)
+                return false;
+        }
+        value = values_[pos & mask_];
+        tail_.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * Get the number of values in the ring. It is exact only when no other
+     * thread is pushing or popping.
+     */
+    std::size_t
+    size() const noexcept
+    {
+        const std::size_t tail = tail_.load(std::memory_order_acquire);
+        const std::size_t head = head_.load(std::memory_order_acquire);
+        return head > tail ? head - tail : 0;
+    }
+
+    /**
+     * Get the capacity of the ring.
+     */
+    std::size_t
+    capacity() const noexcept
+    { return capacity_; }
+
+private:
+    const std::size_t capacity_;
+    const std::size_t mask_;
+    std::unique_ptr<T[]> values_;
+    alignas(cache_line_) std::atomic<std::size_t> head_{0};
+    std::size_t tail_cache_ = 0;
+    alignas(cache_line_) std::atomic<std::size_t> tail_{0};
+    std::size_t head_cache_ = 0;
+
+};
+
+};
+
+MMALPP_END
+
+#endif // MMALPP_RING_UTILS_H
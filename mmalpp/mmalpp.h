@@ -2,11 +2,30 @@
 #define MMALPP_H
 
 #include "include/mmalpp_component.h"
+#include "include/mmalpp_component_cache.h"
 #include "include/mmalpp_port.h"
+#include "include/mmalpp_event.h"
+#include "include/mmalpp_offload.h"
+#include "include/mmalpp_parameter.h"
+#include "include/mmalpp_format.h"
+#include "include/mmalpp_stats.h"
 #include "include/mmalpp_types.h"
+#include "include/mmalpp_result.h"
 #include "include/mmalpp_buffer.h"
+#include "include/mmalpp_span.h"
+#include "include/mmalpp_frame.h"
+#include "include/mmalpp_convert.h"
 #include "include/mmalpp_connection.h"
 #include "include/mmalpp_pool.h"
+#include "include/mmalpp_ring_queue.h"
+#include "include/mmalpp_queue_set.h"
+#include "include/mmalpp_executor.h"
+#include "include/mmalpp_coroutine.h"
+#include "include/mmalpp_arena.h"
+#include "include/mmalpp_deferred_release.h"
+#include "include/mmalpp_autotuner.h"
+#include "include/mmalpp_fanout.h"
+#include "include/mmalpp_pipeline.h"
 #include "include/mmalpp_support.h"
 
 #endif // MMALPP_H